@@ -0,0 +1,120 @@
+/*
+ * Host benchmark for the HTTP API tokenizer (wled00/api_args.h)
+ *
+ * Compares looking up every key handleSet() knows about via ApiArgs with scanning the request
+ * once per key, like handleSet() did with String::indexOf() before.
+ * Also checks that both find the same values and reports the hash table probes per lookup.
+ *
+ * g++ -O2 -o bench_api_args tools/bench_api_args.cpp && ./bench_api_args
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//stand-ins for the Arduino core
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define PGM_P const char*
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define DEBUG_PRINT(x)
+#define DEBUG_PRINTLN(x)
+
+#include "../wled00/api_args.h"
+
+//all keys handleSet() looks up, in the order it does
+static const char* keys[] = {
+  "SM","SS","SV","S","S2","GP","SP","P1","P2","CY","PT","PS","PL","A","R","G","B","W","R2","G2","B2","W2",
+  "LX","LY","HU","SA","H2","K","K2","CL","C2","C3","SR","SC","FX","SX","IX","FP","OL","M","SN","RN","RD","T",
+  "ND","NL","NT","NF","AX","TT","RV","MI","SB","ST","CT","LO","RB","NM","NX","NB","U0","U1","IN","NN"
+};
+static const int keyCount = sizeof(keys) / sizeof(keys[0]);
+
+static const char* requests[] = {
+  "win&A=128",
+  "win&T=2",
+  "win&FX=3&SX=128&IX=64",
+  "win&R=255&G=0&B=0&W=0&A=200&FX=0&FP=5",
+  "win&CL=hFF8000&C2=h0000FF&C3=h000000&FX=9&SX=100&IX=100&FP=3&TT=700",
+  "win&SM=1&SS=1&SV=2&S=0&S2=60&GP=1&SP=0&FX=9&SX=100&IX=100&FP=3&CL=hFF0000&C2=h00FF00&C3=h0000FF&T=1&TT=700&RV=0&MI=0",
+};
+static const int requestCount = sizeof(requests) / sizeof(requests[0]);
+
+//the previous way: one scan of the request per key
+static const char* scanArg(const char* req, const char* key, char* pattern)
+{
+  //single character keys were prefixed with '&' so "S=" does not match "SS=", two character keys were not
+  if (key[1]) sprintf(pattern, "%s=", key);
+  else sprintf(pattern, "&%s=", key);
+  const char* p = strstr(req, pattern);
+  return p ? p + strlen(pattern) : nullptr;
+}
+
+static volatile long sink = 0;
+
+int main()
+{
+  const int rounds = 200000;
+  printf("%-32s %10s %10s %7s %7s\n", "request", "scan ns", "table ns", "speedup", "probes");
+
+  for (int r = 0; r < requestCount; r++) {
+    const char* req = requests[r];
+    char pattern[8];
+
+    //same results
+    ApiArgs check(req);
+    for (int k = 0; k < keyCount; k++) {
+      const char* a = scanArg(req, keys[k], pattern);
+      const char* b = check.get(F(keys[k]));
+      if ((a == nullptr) != (b == nullptr) || (a && atoi(a) != atoi(b))) {
+        printf("MISMATCH in \"%s\" for key %s\n", req, keys[k]);
+        return 1;
+      }
+    }
+
+    //average slots inspected per lookup, counted on a copy of the probing in ApiArgs::find()
+    unsigned long probes = 0;
+    {
+      uint16_t table[API_ARGS_SLOTS] = {0};
+      for (int k = 0; k < keyCount; k++) {
+        if (!check.has(F(keys[k]))) continue;
+        uint16_t key = ((uint8_t)keys[k][0] << 8) | (uint8_t)keys[k][1];
+        uint8_t s = (((key >> 8) * 3) ^ ((key & 0xFF) * 93)) & (API_ARGS_SLOTS -1);
+        while (table[s] && table[s] != key) s = (s +1) & (API_ARGS_SLOTS -1);
+        table[s] = key;
+      }
+      for (int k = 0; k < keyCount; k++) {
+        uint16_t key = ((uint8_t)keys[k][0] << 8) | (uint8_t)keys[k][1];
+        uint8_t s = (((key >> 8) * 3) ^ ((key & 0xFF) * 93)) & (API_ARGS_SLOTS -1);
+        probes++;
+        while (table[s] && table[s] != key) { s = (s +1) & (API_ARGS_SLOTS -1); probes++; }
+      }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      for (int k = 0; k < keyCount; k++) {
+        const char* v = scanArg(req, keys[k], pattern);
+        if (v) sink += atoi(v);
+      }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      ApiArgs args(req);
+      for (int k = 0; k < keyCount; k++) {
+        const char* v = args.get(F(keys[k]));
+        if (v) sink += atoi(v);
+      }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double scanNs  = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+    double tableNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds;
+    char name[33];
+    snprintf(name, sizeof(name), "%s", req);
+    printf("%-32s %10.0f %10.0f %6.1fx %7.2f\n", name, scanNs, tableNs, scanNs / tableNs, (double)probes / keyCount);
+  }
+  return 0;
+}
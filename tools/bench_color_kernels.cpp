@@ -0,0 +1,287 @@
+/*
+ * Host benchmark for the packed color kernels in wled00/FX_fcn.cpp: color_blend(), fade_out() and blur()
+ *
+ * Compares each kernel with the per channel code it replaced:
+ * color_blend() exhaustively for every channel pair and blend value, plus random colors,
+ * fade_out() exhaustively for every rate and channel pair, against both the old float code and exact division,
+ * blur() on random segments for every blur amount.
+ * Reports the differing results and the time of both versions.
+ *
+ * Pixels are read and written through a plain array here instead of getPixelColor()/setPixelColor(),
+ * and the host has an FPU, so the numbers show the cost of the kernels alone, not of a frame on the ESP8266.
+ *
+ * g++ -O2 -o bench_color_kernels tools/bench_color_kernels.cpp && ./bench_color_kernels
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#define SEGLEN 300
+
+static uint32_t pixels[SEGLEN];
+static inline uint32_t getPixelColor(uint16_t i) { return pixels[i]; }
+static inline void setPixelColor(uint16_t i, uint32_t c) { pixels[i] = c; }
+static inline void setPixelColor(uint16_t i, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) {
+  pixels[i] = ((uint32_t)w << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+//FastLED scale8() and qadd8() as used by CRGB::nscale8() and CRGB::operator+=
+static inline uint8_t scale8(uint8_t i, uint8_t scale) { return ((uint16_t)i * (1 + scale)) >> 8; }
+static inline uint8_t qadd8(uint8_t i, uint8_t j) { unsigned t = i + j; return t > 255 ? 255 : t; }
+
+/*
+ * color_blend(), 8 bit blend
+ */
+static uint32_t blendOld(uint32_t color1, uint32_t color2, uint16_t blend) {
+  if(blend == 0)   return color1;
+  uint16_t blendmax = 0xFF;
+  if(blend == blendmax) return color2;
+  uint8_t shift = 8;
+
+  uint32_t w1 = (color1 >> 24) & 0xFF;
+  uint32_t r1 = (color1 >> 16) & 0xFF;
+  uint32_t g1 = (color1 >>  8) & 0xFF;
+  uint32_t b1 =  color1        & 0xFF;
+
+  uint32_t w2 = (color2 >> 24) & 0xFF;
+  uint32_t r2 = (color2 >> 16) & 0xFF;
+  uint32_t g2 = (color2 >>  8) & 0xFF;
+  uint32_t b2 =  color2        & 0xFF;
+
+  uint32_t w3 = ((w2 * blend) + (w1 * (blendmax - blend))) >> shift;
+  uint32_t r3 = ((r2 * blend) + (r1 * (blendmax - blend))) >> shift;
+  uint32_t g3 = ((g2 * blend) + (g1 * (blendmax - blend))) >> shift;
+  uint32_t b3 = ((b2 * blend) + (b1 * (blendmax - blend))) >> shift;
+
+  return ((w3 << 24) | (r3 << 16) | (g3 << 8) | (b3));
+}
+
+static uint32_t blendNew(uint32_t color1, uint32_t color2, uint16_t blend) {
+  if(blend == 0)   return color1;
+  if(blend == 0xFF) return color2;
+  uint32_t rb1 =  color1       & 0x00FF00FF;
+  uint32_t wg1 = (color1 >> 8) & 0x00FF00FF;
+  uint32_t rb2 =  color2       & 0x00FF00FF;
+  uint32_t wg2 = (color2 >> 8) & 0x00FF00FF;
+  uint32_t rb3 = ((rb2 * blend + rb1 * (0xFF - blend)) >> 8) & 0x00FF00FF;
+  uint32_t wg3 =  (wg2 * blend + wg1 * (0xFF - blend))       & 0xFF00FF00;
+  return rb3 | wg3;
+}
+
+/*
+ * fade_out(), one channel
+ */
+static int fadeOld(int c1, int c2, uint8_t rate) {
+  rate = (255-rate) >> 1;
+  float mappedRate = float(rate) +1.1;
+  int delta = (c2 - c1) / mappedRate;
+  delta += (c2 == c1) ? 0 : (c2 > c1) ? 1 : -1;
+  return c1 + delta;
+}
+
+static inline int fadeDelta(int c1, int c2, uint32_t inv) {
+  if (c2 > c1) return (((uint32_t)(c2 - c1) * inv) >> 24) +1;
+  if (c2 < c1) return -(int)(((uint32_t)(c1 - c2) * inv) >> 24) -1;
+  return 0;
+}
+
+static uint32_t fadeInv(uint8_t rate) {
+  rate = (255-rate) >> 1;
+  uint32_t divisor = rate * 10 + 11;
+  return ((10UL << 24) + divisor -1) / divisor;
+}
+
+//(c2 - c1) / (rate + 1.1) in integers, truncated towards zero
+static int fadeExact(int c1, int c2, uint8_t rate) {
+  rate = (255-rate) >> 1;
+  int delta = (c2 - c1) * 10 / (rate * 10 + 11);
+  delta += (c2 == c1) ? 0 : (c2 > c1) ? 1 : -1;
+  return c1 + delta;
+}
+
+static void fadeOutOld(uint8_t rate, uint32_t color) {
+  rate = (255-rate) >> 1;
+  float mappedRate = float(rate) +1.1;
+  int w2 = (color >> 24) & 0xff;
+  int r2 = (color >> 16) & 0xff;
+  int g2 = (color >>  8) & 0xff;
+  int b2 =  color        & 0xff;
+  for(uint16_t i = 0; i < SEGLEN; i++) {
+    color = getPixelColor(i);
+    int w1 = (color >> 24) & 0xff;
+    int r1 = (color >> 16) & 0xff;
+    int g1 = (color >>  8) & 0xff;
+    int b1 =  color        & 0xff;
+    int wdelta = (w2 - w1) / mappedRate;
+    int rdelta = (r2 - r1) / mappedRate;
+    int gdelta = (g2 - g1) / mappedRate;
+    int bdelta = (b2 - b1) / mappedRate;
+    wdelta += (w2 == w1) ? 0 : (w2 > w1) ? 1 : -1;
+    rdelta += (r2 == r1) ? 0 : (r2 > r1) ? 1 : -1;
+    gdelta += (g2 == g1) ? 0 : (g2 > g1) ? 1 : -1;
+    bdelta += (b2 == b1) ? 0 : (b2 > b1) ? 1 : -1;
+    setPixelColor(i, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+  }
+}
+
+static void fadeOutNew(uint8_t rate, uint32_t color) {
+  uint32_t inv = fadeInv(rate);
+  int w2 = (color >> 24) & 0xff;
+  int r2 = (color >> 16) & 0xff;
+  int g2 = (color >>  8) & 0xff;
+  int b2 =  color        & 0xff;
+  for(uint16_t i = 0; i < SEGLEN; i++) {
+    color = getPixelColor(i);
+    int w1 = (color >> 24) & 0xff;
+    int r1 = (color >> 16) & 0xff;
+    int g1 = (color >>  8) & 0xff;
+    int b1 =  color        & 0xff;
+    setPixelColor(i, r1 + fadeDelta(r1, r2, inv), g1 + fadeDelta(g1, g2, inv), b1 + fadeDelta(b1, b2, inv), w1 + fadeDelta(w1, w2, inv));
+  }
+}
+
+/*
+ * blur()
+ */
+static void blurOld(uint8_t blur_amount) {
+  uint8_t keep = 255 - blur_amount;
+  uint8_t seep = blur_amount >> 1;
+  uint8_t carry[3] = {0, 0, 0};
+  for(uint16_t i = 0; i < SEGLEN; i++)
+  {
+    uint32_t c = getPixelColor(i);
+    uint8_t cur[3] = {(uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c};
+    uint8_t part[3];
+    for (int k = 0; k < 3; k++) {
+      part[k] = scale8(cur[k], seep);
+      cur[k] = qadd8(scale8(cur[k], keep), carry[k]);
+    }
+    if(i > 0) {
+      c = getPixelColor(i-1);
+      uint8_t r = (c >> 16 & 0xFF);
+      uint8_t g = (c >> 8  & 0xFF);
+      uint8_t b = (c       & 0xFF);
+      setPixelColor(i-1, qadd8(r, part[0]), qadd8(g, part[1]), qadd8(b, part[2]));
+    }
+    setPixelColor(i, cur[0], cur[1], cur[2]);
+    for (int k = 0; k < 3; k++) carry[k] = part[k];
+  }
+}
+
+static uint32_t addSeep(uint32_t a, uint32_t b)
+{
+  uint32_t rbSum = (a & 0x00FF00FF) + (b & 0x00FF00FF);
+  uint32_t gSum  = ((a >> 8) & 0xFF) + ((b >> 8) & 0xFF);
+  uint32_t ov = rbSum & 0x01000100;
+  rbSum = (rbSum | (ov - (ov >> 8))) & 0x00FF00FF;
+  if (gSum > 0xFF) gSum = 0xFF;
+  return rbSum | (gSum << 8);
+}
+
+static void blurNew(uint8_t blur_amount) {
+  uint16_t keep = 256 - blur_amount;
+  uint16_t seep = (blur_amount >> 1) +1;
+  uint32_t carryover = 0;
+  uint32_t prev = 0;
+  for(uint16_t i = 0; i < SEGLEN; i++)
+  {
+    uint32_t c = getPixelColor(i);
+    uint32_t rb = c & 0x00FF00FF;
+    uint32_t g  = (c >> 8) & 0xFF;
+    uint32_t part = (((rb * seep) >> 8) & 0x00FF00FF) | (((g * seep) >> 8) << 8);
+    uint32_t cur  = (((rb * keep) >> 8) & 0x00FF00FF) | (((g * keep) >> 8) << 8);
+    cur += carryover;
+    if(i > 0) setPixelColor(i-1, addSeep(prev, part));
+    setPixelColor(i, cur);
+    prev = cur;
+    carryover = part;
+  }
+}
+
+static uint32_t seed = 1;
+static inline uint32_t rnd() { seed = seed * 1664525 + 1013904223; return seed; }
+
+static volatile uint32_t sink = 0;
+
+template<typename F> static double timeUs(F f) {
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main()
+{
+  //color_blend: every channel pair and blend, the neighbour lanes hold the inverted values to catch carries between lanes
+  long blendDiff = 0;
+  for (uint32_t a = 0; a < 256; a++)
+    for (uint32_t b = 0; b < 256; b++) {
+      uint32_t c1 = a * 0x00010001 | (255 - a) * 0x01000100;
+      uint32_t c2 = b * 0x00010001 | (255 - b) * 0x01000100;
+      for (uint32_t blend = 0; blend < 256; blend++)
+        if (blendOld(c1, c2, blend) != blendNew(c1, c2, blend)) blendDiff++;
+    }
+  const int blendRounds = 10000000;
+  for (int i = 0; i < blendRounds; i++) {
+    uint32_t c1 = rnd(), c2 = rnd(), blend = rnd() >> 24;
+    if (blendOld(c1, c2, blend) != blendNew(c1, c2, blend)) blendDiff++;
+  }
+  printf("color_blend: %ld of %ld results differ\n", blendDiff, 256L * 256 * 256 + blendRounds);
+
+  //fade_out: every rate and channel pair
+  long fadeVsFloat = 0, fadeVsExact = 0, floatVsExact = 0;
+  int shown = 0;
+  for (int rate = 0; rate < 256; rate++) {
+    uint32_t inv = fadeInv(rate);
+    for (int c1 = 0; c1 < 256; c1++)
+      for (int c2 = 0; c2 < 256; c2++) {
+        int old = fadeOld(c1, c2, rate), now = c1 + fadeDelta(c1, c2, inv), exact = fadeExact(c1, c2, rate);
+        if (now != exact) fadeVsExact++;
+        if (old != exact) floatVsExact++;
+        if (now != old) {
+          fadeVsFloat++;
+          if (shown++ < 3) printf("  fade_out rate %d, %d -> %d: %d, float code %d\n", rate, c1, c2, now, old);
+        }
+      }
+  }
+  printf("fade_out: of %d results %ld differ from the float code, %ld from exact division (float code: %ld)\n",
+    256 * 256 * 256, fadeVsFloat, fadeVsExact, floatVsExact);
+
+  //blur: random segments, every blur amount
+  long blurDiff = 0;
+  for (int run = 0; run < 200; run++)
+    for (int amount = 0; amount < 256; amount++) {
+      uint32_t in[SEGLEN], out[SEGLEN];
+      for (int i = 0; i < SEGLEN; i++) in[i] = (run & 1) ? rnd() : (rnd() | 0x00F0F0F0); //odd runs bright, to saturate
+      for (int i = 0; i < SEGLEN; i++) pixels[i] = in[i];
+      blurOld(amount);
+      for (int i = 0; i < SEGLEN; i++) { out[i] = pixels[i]; pixels[i] = in[i]; }
+      blurNew(amount);
+      for (int i = 0; i < SEGLEN; i++) if (pixels[i] != out[i]) blurDiff++;
+    }
+  printf("blur: %ld of %d pixels differ\n", blurDiff, 200 * 256 * SEGLEN);
+
+  //timing
+  printf("\n%-12s %10s %10s %8s\n", "kernel", "old us", "new us", "speedup");
+  const int n = 2000000;
+  static uint32_t c1s[1024], c2s[1024];
+  for (int i = 0; i < 1024; i++) { c1s[i] = rnd(); c2s[i] = rnd(); }
+  double o = timeUs([&]{ uint32_t s = 0; for (int i = 0; i < n; i++) s += blendOld(c1s[i & 1023], c2s[i & 1023], 1 + (i % 254)); sink += s; });
+  double w = timeUs([&]{ uint32_t s = 0; for (int i = 0; i < n; i++) s += blendNew(c1s[i & 1023], c2s[i & 1023], 1 + (i % 254)); sink += s; });
+  printf("%-12s %10.0f %10.0f %7.2fx  (%d blends)\n", "color_blend", o, w, o / w, n);
+
+  const int frames = 5000;
+  for (int i = 0; i < SEGLEN; i++) pixels[i] = rnd();
+  o = timeUs([&]{ for (int f = 0; f < frames; f++) { fadeOutOld(f & 0xFF, c1s[f & 1023]); sink += pixels[f % SEGLEN]; } });
+  for (int i = 0; i < SEGLEN; i++) pixels[i] = rnd();
+  w = timeUs([&]{ for (int f = 0; f < frames; f++) { fadeOutNew(f & 0xFF, c1s[f & 1023]); sink += pixels[f % SEGLEN]; } });
+  printf("%-12s %10.0f %10.0f %7.2fx  (%d frames of %d pixels)\n", "fade_out", o, w, o / w, frames, SEGLEN);
+
+  for (int i = 0; i < SEGLEN; i++) pixels[i] = rnd();
+  o = timeUs([&]{ for (int f = 0; f < frames; f++) { blurOld(f & 0xFF); pixels[f % SEGLEN] = c1s[f & 1023]; } });
+  for (int i = 0; i < SEGLEN; i++) pixels[i] = rnd();
+  w = timeUs([&]{ for (int f = 0; f < frames; f++) { blurNew(f & 0xFF); pixels[f % SEGLEN] = c1s[f & 1023]; } });
+  printf("%-12s %10.0f %10.0f %7.2fx  (%d frames of %d pixels)\n", "blur", o, w, o / w, frames, SEGLEN);
+  return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * Host benchmark for the Q16.16 fixed point physics effects (wled00/FX.cpp)
+ *
+ * Runs the motion of bouncing balls, popcorn, exploding fireworks, drip, starburst and aurora
+ * once with the float code they used before and once with the Q16.16 code they use now,
+ * over a sweep of segment lengths, speeds and start values.
+ * Reports the largest difference of the drawn pixel positions (aurora: of the color levels),
+ * how many outputs differ by more than 1, the largest difference when the other version may be
+ * one frame ahead or behind (a bounce or explosion landing on the next frame), and the time per sweep.
+ *
+ * The host has an FPU, so the speed-up here understates the one on the ESP8266,
+ * where every float operation is a call into the software float library.
+ *
+ * g++ -O2 -o bench_q16_physics tools/bench_q16_physics.cpp && ./bench_q16_physics
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//copies of the helpers at the top of the physics section in FX.cpp
+typedef int32_t q16;
+#define Q16_ONE   65536
+#define Q16(x)    ((q16)((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+inline q16 q16mul(q16 a, q16 b) {
+  return ((int64_t)a * b) >> 16;
+}
+
+inline int32_t q16int(q16 a) {
+  return (a < 0) ? -((-a) >> 16) : (a >> 16);
+}
+
+q16 q16sqrt(int64_t a) {
+  if (a <= 0) return 0;
+  uint64_t x = (uint64_t)a << 16, res = 0, bit = (uint64_t)1 << 62;
+  while (bit > x) bit >>= 2;
+  while (bit) {
+    if (x >= res + bit) { x -= res + bit; res = (res >> 1) + bit; }
+    else res >>= 1;
+    bit >>= 2;
+  }
+  return res;
+}
+
+q16 q16gravity(uint32_t num, uint32_t den, uint16_t len) {
+  return -(q16)(((int64_t)num * len << 16) / den);
+}
+
+#define constrain(v,lo,hi) ((v)<(lo)?(lo):((v)>(hi)?(hi):(v)))
+
+#define FRAMETIME_MS 24  //WLED_FPS 42
+#define STARBURST_MAX_FRAG 12
+#define W_MAX_SPEED 6
+#define MAX_OUT 65536
+
+//one run of an effect: segment length, speed slider and two effect specific start values
+struct Case {
+  uint16_t len;
+  uint8_t speed;
+  uint16_t a, b;
+};
+
+typedef int (*SimFn)(const Case& c, int16_t* out);
+
+/*
+ * Bouncing balls, a = number of balls, 20 s of frames
+ */
+int ballsFloat(const Case& c, int16_t* out) {
+  struct { unsigned long lastBounceTime; float impactVelocity; float height; } balls[16] = {};
+  float gravity = -9.81;
+  float impactVelocityStart = sqrt(-2 * gravity);
+  int n = 0;
+  for (unsigned long time = 0; time < 20000; time += FRAMETIME_MS) {
+    for (uint8_t i = 0; i < c.a; i++) {
+      float timeSinceLastBounce = (time - balls[i].lastBounceTime)/((255-c.speed)*8/256 +1);
+      balls[i].height = 0.5 * gravity * pow(timeSinceLastBounce/1000 , 2.0) + balls[i].impactVelocity * timeSinceLastBounce/1000;
+      if (balls[i].height < 0) {
+        balls[i].height = 0;
+        float dampening = 0.90 - float(i)/pow(c.a,2);
+        balls[i].impactVelocity = dampening * balls[i].impactVelocity;
+        balls[i].lastBounceTime = time;
+        if (balls[i].impactVelocity < 0.015) balls[i].impactVelocity = impactVelocityStart;
+      }
+      out[n++] = (uint16_t)round(balls[i].height * (c.len - 1));
+    }
+  }
+  return n;
+}
+
+int ballsQ16(const Case& c, int16_t* out) {
+  struct { unsigned long lastBounceTime; q16 impactVelocity; q16 height; } balls[16] = {};
+  const q16 halfGravity         = Q16(-9.81 / 2);
+  const q16 impactVelocityStart = Q16(4.4294469);
+  int n = 0;
+  for (unsigned long time = 0; time < 20000; time += FRAMETIME_MS) {
+    for (uint8_t i = 0; i < c.a; i++) {
+      int64_t timeSinceLastBounce = (time - balls[i].lastBounceTime)/((255-c.speed)*8/256 +1);
+      if (timeSinceLastBounce > 10000) timeSinceLastBounce = 10000;
+      balls[i].height = (halfGravity * timeSinceLastBounce * timeSinceLastBounce) / 1000000 + (balls[i].impactVelocity * timeSinceLastBounce) / 1000;
+      if (balls[i].height < 0) {
+        balls[i].height = 0;
+        int32_t balls2 = c.a * c.a;
+        balls[i].impactVelocity = ((int64_t)balls[i].impactVelocity * (9 * balls2 - 10 * i)) / (10 * balls2);
+        balls[i].lastBounceTime = time;
+        if (balls[i].impactVelocity < Q16(0.015)) balls[i].impactVelocity = impactVelocityStart;
+      }
+      out[n++] = ((int64_t)balls[i].height * (c.len - 1) + (Q16_ONE >> 1)) >> 16;
+    }
+  }
+  return n;
+}
+
+/*
+ * Popcorn, a = peak height 128-255, one kernel from pop until it falls below 0
+ */
+int popcornFloat(const Case& c, int16_t* out) {
+  float gravity = -0.0001 - (c.speed/200000.0);
+  gravity *= c.len;
+  uint16_t peakHeight = (c.a * (c.len -1)) >> 8;
+  float pos = 0.01f;
+  float vel = sqrt(-2.0 * gravity * peakHeight);
+  int n = 0;
+  while (pos >= 0.0f && n < MAX_OUT) {
+    pos += vel;
+    vel += gravity;
+    out[n++] = (int)pos;
+  }
+  return n;
+}
+
+int popcornQ16(const Case& c, int16_t* out) {
+  q16 gravity = q16gravity(20 + c.speed, 200000, c.len);
+  uint16_t peakHeight = (c.a * (c.len -1)) >> 8;
+  q16 pos = Q16(0.01);
+  q16 vel = q16sqrt(-2LL * gravity * peakHeight);
+  int n = 0;
+  while (pos >= 0 && n < MAX_OUT) {
+    pos += vel;
+    vel += gravity;
+    out[n++] = q16int(pos);
+  }
+  return n;
+}
+
+/*
+ * Exploding fireworks, a = flare peak height 75-254, b = random16(0, 20000) of the spark velocity
+ * flare from launch to explosion, then one spark while the sparks are lit
+ */
+int fireworksFloat(const Case& c, int16_t* out) {
+  float gravity = -0.0004 - (c.speed/800000.0);
+  gravity *= c.len;
+  uint16_t peakHeight = (c.a * (c.len -1)) >> 8;
+  float pos = 0;
+  float vel = sqrt(-2.0 * gravity * peakHeight);
+  int n = 0;
+  while (vel > 12 * gravity && n < MAX_OUT) {
+    out[n++] = int(pos);
+    pos += vel;
+    pos = constrain(pos, 0, c.len-1);
+    vel += gravity;
+  }
+  float flarePos = pos;
+  float dying_gravity = gravity/2;
+  vel = (float(c.b) / 10000.0) - 0.9;
+  vel *= flarePos/c.len;
+  vel *= -gravity *50;
+  for (int col = 345; col > 4; col -= 4) {
+    pos += vel;
+    vel += dying_gravity;
+    out[n++] = int(pos);
+    dying_gravity *= .99;
+  }
+  return n;
+}
+
+int fireworksQ16(const Case& c, int16_t* out) {
+  q16 gravity = q16gravity(320 + c.speed, 800000, c.len);
+  uint16_t peakHeight = (c.a * (c.len -1)) >> 8;
+  q16 pos = 0;
+  q16 vel = q16sqrt(-2LL * gravity * peakHeight);
+  int n = 0;
+  while (vel > 12 * gravity && n < MAX_OUT) {
+    out[n++] = q16int(pos);
+    pos += vel;
+    vel += gravity;
+    pos = constrain(pos, 0, (q16)(c.len-1) << 16);
+  }
+  q16 flarePos = pos;
+  q16 dying_gravity = gravity/2;
+  vel = (((q16)c.b << 16) / 10000) - Q16(0.9);
+  vel = q16mul(vel, flarePos/c.len);
+  vel = q16mul(vel, -gravity *50);
+  for (int col = 345; col > 4; col -= 4) {
+    pos += vel;
+    vel += dying_gravity;
+    out[n++] = q16int(pos);
+    dying_gravity = q16mul(dying_gravity, Q16(0.99));
+  }
+  return n;
+}
+
+/*
+ * Drip, one drop falling from the end of the segment, bouncing once and falling again
+ */
+int dripFloat(const Case& c, int16_t* out) {
+  float gravity = -0.001 - (c.speed/50000.0);
+  gravity *= c.len;
+  float pos = c.len-1, vel = 0;
+  int state = 2, n = 0;
+  while (n < MAX_OUT) {
+    if (pos > 0) {
+      pos += vel;
+      if (pos < 0) pos = 0;
+      vel += gravity;
+      out[n++] = int(pos);
+    } else {
+      if (state > 2) break;
+      vel = -vel/4;
+      pos += vel;
+      state = 5;
+    }
+  }
+  return n;
+}
+
+int dripQ16(const Case& c, int16_t* out) {
+  q16 gravity = q16gravity(50 + c.speed, 50000, c.len);
+  q16 pos = (q16)(c.len-1) << 16, vel = 0;
+  int state = 2, n = 0;
+  while (n < MAX_OUT) {
+    if (pos > 0) {
+      pos += vel;
+      vel += gravity;
+      if (pos < 0) pos = 0;
+      out[n++] = pos >> 16;
+    } else {
+      if (state > 2) break;
+      vel = -vel/4;
+      pos += vel;
+      state = 5;
+    }
+  }
+  return n;
+}
+
+/*
+ * Starburst, a = start position, b = the two random8() of the velocity (high and low byte)
+ * first and last pixel of every fragment and its mirror until the star has faded, frames of 24 or 25 ms
+ */
+int starburstFloat(const Case& c, int16_t* out) {
+  float maxSpeed = 375.0f, particleIgnition = 250.0f, particleFadeTime = 1500.0f;
+  float multiplier = (float)(c.b & 0xFF)/255.0 * 1.0;
+  float vel = maxSpeed * (float)(c.b >> 8)/255.0 * multiplier;
+  float fragment[STARBURST_MAX_FRAG];
+  for (int i = 0; i < STARBURST_MAX_FRAG; i++) fragment[i] = c.a;
+  uint32_t it = 0, last = 0;
+  int n = 0;
+  for (int frame = 1; ; frame++) {
+    it += FRAMETIME_MS + (frame % 3 == 0);
+    float dt = (it-last)/1000.0;
+    for (int i = 0; i < STARBURST_MAX_FRAG; i++) {
+      int var = i >> 1;
+      if (fragment[i] > 0) fragment[i] += vel * dt * (float)var/3.0;
+    }
+    last = it;
+    vel -= 3*vel*dt;
+
+    float fade = 0.0f;
+    float age = it;
+    if (age >= particleIgnition) {
+      if (age > particleIgnition + particleFadeTime) break;
+      fade = (age - particleIgnition) / particleFadeTime;
+    }
+    float particleSize = (1.0 - fade) * 2;
+    for (uint8_t index = 0; index < STARBURST_MAX_FRAG*2; index++) {
+      uint8_t i = index >> 1;
+      float loc = fragment[i];
+      if (index & 0x1) loc -= (loc-c.a)*2;
+      int start = loc - particleSize;
+      int end = loc + particleSize;
+      if (start < 0) start = 0;
+      if (start == end) end++;
+      if (end > c.len) end = c.len;
+      out[n++] = start;
+      out[n++] = end;
+    }
+  }
+  return n;
+}
+
+int starburstQ16(const Case& c, int16_t* out) {
+  const uint16_t maxSpeed = 375, particleIgnition = 250, particleFadeTime = 1500;
+  q16 vel = ((int64_t)maxSpeed * (c.b >> 8) * (c.b & 0xFF) << 16) / (255 * 255);
+  q16 fragment[STARBURST_MAX_FRAG];
+  for (int i = 0; i < STARBURST_MAX_FRAG; i++) fragment[i] = (q16)c.a << 16;
+  uint32_t it = 0, last = 0;
+  int n = 0;
+  for (int frame = 1; ; frame++) {
+    it += FRAMETIME_MS + (frame % 3 == 0);
+    uint32_t dtMs = it-last;
+    if (dtMs > 1000) dtMs = 1000;
+    q16 dt = ((int64_t)dtMs << 16) / 1000;
+    q16 step = q16mul(vel, dt);
+    for (int i = 0; i < STARBURST_MAX_FRAG; i++) {
+      int var = i >> 1;
+      if (fragment[i] > 0) fragment[i] += step * var / 3;
+    }
+    last = it;
+    vel -= q16mul(3*vel, dt);
+
+    q16 fade = 0;
+    uint32_t age = it;
+    if (age >= particleIgnition) {
+      if (age > particleIgnition + particleFadeTime) break;
+      fade = ((int64_t)(age - particleIgnition) << 16) / particleFadeTime;
+    }
+    q16 particleSize = (Q16_ONE - fade) * 2;
+    for (uint8_t index = 0; index < STARBURST_MAX_FRAG*2; index++) {
+      uint8_t i = index >> 1;
+      q16 loc = fragment[i];
+      if (index & 0x1) loc = ((q16)c.a << 17) - loc;
+      int start = q16int(loc - particleSize);
+      int end = q16int(loc + particleSize);
+      if (start < 0) start = 0;
+      if (start == end) end++;
+      if (end > c.len) end = c.len;
+      out[n++] = start;
+      out[n++] = end;
+    }
+  }
+  return n;
+}
+
+/*
+ * Aurora, one wave over its lifetime, red level of every pixel in every 8th frame
+ * a packs the random() results of init(): ttl, basealpha, width, center, direction and speed factor
+ */
+struct AuroraInit { uint16_t ttl, alpha, width, center, left, speedFactor; };
+
+AuroraInit auroraInit(const Case& c) {
+  static const uint16_t ttls[] = {500, 1000, 1500}, alphas[] = {60, 100}, centers[] = {0, 50, 100}, factors[] = {10, 30};
+  uint16_t a = c.a;
+  AuroraInit w;
+  w.ttl = ttls[a % 3]; a /= 3;
+  w.alpha = alphas[a % 2]; a /= 2;
+  w.width = (a % 2) ? c.len / 6 : c.len / 20; a /= 2;
+  if (!w.width) w.width = 1;
+  w.center = centers[a % 3]; a /= 3;
+  w.left = a % 2; a /= 2;
+  w.speedFactor = factors[a % 2];
+  return w;
+}
+
+int auroraFloat(const Case& c, int16_t* out) {
+  AuroraInit w = auroraInit(c);
+  float basealpha = w.alpha / (float)100;
+  float center = w.center / (float)100 * c.len;
+  float speed_factor = (w.speedFactor / (float)100 * W_MAX_SPEED / 255);
+  uint16_t ttl = w.ttl, width = w.width, age = 0;
+  int n = 0;
+  while (n < MAX_OUT - c.len) {
+    if (w.left) center -= speed_factor * c.speed;
+    else center += speed_factor * c.speed;
+    age++;
+    if (age > ttl) break;
+    if (w.left ? (center + width < 0) : (center - width > c.len)) break;
+    if (age & 7) continue;
+    for (int led = 0; led < c.len; led++) {
+      uint8_t r = 0;
+      if (!(led < center - width || led > center + width)) {
+        float offset = led - center;
+        if (offset < 0) offset = -offset;
+        float offsetFactor = offset / width;
+        float ageFactor = 0.1;
+        if ((float)age / ttl < 0.5) ageFactor = (float)age / (ttl / 2);
+        else ageFactor = (float)(ttl - age) / ((float)ttl * 0.5);
+        float factor = (1 - offsetFactor) * ageFactor * basealpha;
+        r = 255 * factor;
+      }
+      out[n++] = r;
+    }
+  }
+  return n;
+}
+
+int auroraQ16(const Case& c, int16_t* out) {
+  AuroraInit w = auroraInit(c);
+  q16 basealpha = (w.alpha << 16) / 100;
+  q16 center = ((int64_t)w.center * c.len << 16) / 100;
+  q16 speed_factor = ((int64_t)w.speedFactor * W_MAX_SPEED << 16) / (100 * 255);
+  uint16_t ttl = w.ttl, width = w.width, age = 0;
+  int n = 0;
+  while (n < MAX_OUT - c.len) {
+    if (w.left) center -= speed_factor * c.speed;
+    else center += speed_factor * c.speed;
+    age++;
+    if (age > ttl) break;
+    if (w.left ? (center + ((q16)width << 16) < 0) : (center - ((q16)width << 16) > ((q16)c.len << 16))) break;
+    if (age & 7) continue;
+    for (int led = 0; led < c.len; led++) {
+      uint8_t r = 0;
+      q16 pos = (q16)led << 16;
+      q16 wd = (q16)width << 16;
+      if (!(pos < center - wd || pos > center + wd)) {
+        q16 offset = pos - center;
+        if (offset < 0) offset = -offset;
+        q16 offsetFactor = offset / width;
+        q16 ageFactor;
+        if (2 * age < ttl) ageFactor = ((q16)age << 16) / (ttl / 2);
+        else ageFactor = ((q16)(ttl - age) << 17) / ttl;
+        q16 factor = q16mul(q16mul(Q16_ONE - offsetFactor, ageFactor), basealpha);
+        r = (255 * factor) >> 16;
+      }
+      out[n++] = r;
+    }
+  }
+  return n;
+}
+
+//outputs per frame
+int perFrameOne(const Case& c)       { return 1; }
+int perFrameBalls(const Case& c)     { return c.a; }
+int perFrameStarburst(const Case& c) { return STARBURST_MAX_FRAG * 4; }
+int perFrameAurora(const Case& c)    { return c.len; }
+
+struct Effect {
+  const char* name;
+  const char* unit;
+  SimFn simFloat, simQ16;
+  int (*perFrame)(const Case& c);
+  uint16_t aFrom, aTo, aStep, bFrom, bTo, bStep;
+};
+
+static const Effect effects[] = {
+  {"bouncing balls",     "px",  ballsFloat,     ballsQ16,     perFrameBalls,     1,   16,  3, 0,      0,      1},
+  {"popcorn",            "px",  popcornFloat,   popcornQ16,   perFrameOne,       128, 255, 1, 0,      0,      1},
+  {"exploding fireworks","px",  fireworksFloat, fireworksQ16, perFrameOne,       75,  254, 1, 0,      20000,  2500},
+  {"drip",               "px",  dripFloat,      dripQ16,      perFrameOne,       0,   0,   1, 0,      0,      1},
+  {"starburst",          "px",  starburstFloat, starburstQ16, perFrameStarburst, 1,   29,  7, 0x0101, 0xFFFF, 0x0F0F},
+  {"aurora",             "lvl", auroraFloat,    auroraQ16,    perFrameAurora,    0,   143, 1, 0,      0,      1},
+};
+
+static const uint16_t lengths[] = {30, 150, 300};
+static const uint8_t speeds[] = {0, 64, 128, 192, 255};
+
+static int16_t outFloat[MAX_OUT], outQ16[MAX_OUT];
+static volatile long sink = 0;
+
+int main()
+{
+  printf("%-20s %6s %9s %8s %7s %8s %9s %9s %7s\n", "effect", "cases", "outputs", "max dev", ">1", "+-1 frm", "float us", "q16 us", "speedup");
+
+  for (const Effect& e : effects) {
+    std::vector<Case> cases;
+    for (uint16_t len : lengths)
+      for (uint8_t speed : speeds)
+        for (uint32_t a = e.aFrom; a <= e.aTo; a += e.aStep)
+          for (uint32_t b = e.bFrom; b <= e.bTo; b += e.bStep)
+            if (e.simFloat != starburstFloat || a < len - 1U) cases.push_back({len, speed, (uint16_t)a, (uint16_t)b});
+
+    //deviation, outputs of runs that end after a different number of frames are compared up to the shorter one
+    //a bounce or explosion one frame earlier or later shifts the rest of the run, so also compare with the neighbouring frames
+    long outputs = 0, over = 0, lengthDiff = 0;
+    int maxDev = 0, maxDevShifted = 0;
+    for (const Case& c : cases) {
+      int nf = e.simFloat(c, outFloat);
+      int nq = e.simQ16(c, outQ16);
+      int s = e.perFrame(c);
+      int n = (nf < nq) ? nf : nq;
+      if (nf != nq) lengthDiff++;
+      for (int i = 0; i < n; i++) {
+        int d = abs(outFloat[i] - outQ16[i]);
+        if (d > maxDev) maxDev = d;
+        if (d > 1) over++;
+        if (i >= s     && abs(outFloat[i] - outQ16[i - s]) < d) d = abs(outFloat[i] - outQ16[i - s]);
+        if (i + s < nq && abs(outFloat[i] - outQ16[i + s]) < d) d = abs(outFloat[i] - outQ16[i + s]);
+        if (d > maxDevShifted) maxDevShifted = d;
+      }
+      outputs += n;
+    }
+
+    const int rounds = 20;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+      for (const Case& c : cases) sink += e.simFloat(c, outFloat) + outFloat[0];
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+      for (const Case& c : cases) sink += e.simQ16(c, outQ16) + outQ16[0];
+    auto t2 = std::chrono::steady_clock::now();
+
+    double floatUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds;
+    double q16Us   = std::chrono::duration<double, std::micro>(t2 - t1).count() / rounds;
+    char dev[16], devShifted[16];
+    snprintf(dev, sizeof(dev), "%d %s", maxDev, e.unit);
+    snprintf(devShifted, sizeof(devShifted), "%d %s", maxDevShifted, e.unit);
+    printf("%-20s %6zu %9ld %8s %6.2f%% %8s %9.0f %9.0f %6.2fx\n", e.name, cases.size(), outputs, dev,
+      100.0 * over / (outputs ? outputs : 1), devShifted, floatUs, q16Us, floatUs / q16Us);
+    if (lengthDiff) printf("%-20s %ld of %zu runs end after a different number of frames\n", "", lengthDiff, cases.size());
+  }
+  return 0;
+}
@@ -177,39 +177,22 @@ void userLoop() {
 
   // Third row with mode name
   tft.setCursor(1, 68);
-  uint8_t qComma = 0;
-  bool insideQuotes = false;
   uint8_t printedChars = 0;
-  char singleJsonSymbol;
-  // Find the mode name in JSON
-  for (size_t i = 0; i < strlen_P(JSON_mode_names); i++) {
-    singleJsonSymbol = pgm_read_byte_near(JSON_mode_names + i);
-    switch (singleJsonSymbol) {
-    case '"':
-      insideQuotes = !insideQuotes;
-      break;
-    case '[':
-    case ']':
-      break;
-    case ',':
-      qComma++;
-    default:
-      if (!insideQuotes || (qComma != knownMode))
-        break;
-      tft.print(singleJsonSymbol);
-      printedChars++;
-    }
-    if ((qComma > knownMode) || (printedChars > tftcharwidth - 1))
-      break;
+  // Mode name from the effect table
+  const char* modeName = strip.getModeName(knownMode);
+  size_t modeNameLen = strlen_P(modeName);
+  for (size_t i = 0; i < modeNameLen && printedChars <= tftcharwidth - 1; i++) {
+    tft.print((char)pgm_read_byte_near(modeName + i));
+    printedChars++;
   }
   // Fourth row with palette name
   tft.setCursor(1, 90);
-  qComma = 0;
-  insideQuotes = false;
+  uint8_t qComma = 0;
+  bool insideQuotes = false;
   printedChars = 0;
   // Looking for palette name in JSON.
   for (size_t i = 0; i < strlen_P(JSON_palette_names); i++) {
-    singleJsonSymbol = pgm_read_byte_near(JSON_palette_names + i);
+    char singleJsonSymbol = pgm_read_byte_near(JSON_palette_names + i);
     switch (singleJsonSymbol) {
     case '"':
       insideQuotes = !insideQuotes;
@@ -185,40 +185,23 @@ void userLoop() {
 
   // Third row with mode name
   u8x8.setCursor(2, 2);
-  uint8_t qComma = 0;
-  bool insideQuotes = false;
   uint8_t printedChars = 0;
-  char singleJsonSymbol;
 
-  // Find the mode name in JSON
-  for (size_t i = 0; i < strlen_P(JSON_mode_names); i++) {
-    singleJsonSymbol = pgm_read_byte_near(JSON_mode_names + i);
-    switch (singleJsonSymbol) {
-    case '"':
-      insideQuotes = !insideQuotes;
-      break;
-    case '[':
-    case ']':
-      break;
-    case ',':
-      qComma++;
-    default:
-      if (!insideQuotes || (qComma != knownMode))
-        break;
-      u8x8.print(singleJsonSymbol);
-      printedChars++;
-    }
-    if ((qComma > knownMode) || (printedChars > u8x8.getCols() - 2))
-      break;
+  // Mode name from the effect table
+  const char* modeName = strip.getModeName(knownMode);
+  size_t modeNameLen = strlen_P(modeName);
+  for (size_t i = 0; i < modeNameLen && printedChars <= u8x8.getCols() - 2; i++) {
+    u8x8.print((char)pgm_read_byte_near(modeName + i));
+    printedChars++;
   }
   // Fourth row with palette name
   u8x8.setCursor(2, 3);
-  qComma = 0;
-  insideQuotes = false;
+  uint8_t qComma = 0;
+  bool insideQuotes = false;
   printedChars = 0;
   // Looking for palette name in JSON.
   for (size_t i = 0; i < strlen_P(JSON_palette_names); i++) {
-    singleJsonSymbol = pgm_read_byte_near(JSON_palette_names + i);
+    char singleJsonSymbol = pgm_read_byte_near(JSON_palette_names + i);
     switch (singleJsonSymbol) {
     case '"':
       insideQuotes = !insideQuotes;
@@ -1138,7 +1138,7 @@ uint16_t WS2812FX::mode_fireworks() {
 
   for(uint16_t i=0; i<MAX(1, SEGLEN/20); i++) {
     if(random8(129 - (SEGMENT.intensity >> 1)) == 0) {
-      uint16_t index = random(SEGLEN);
+      uint16_t index = random16(SEGLEN);
       setPixelColor(index, color_from_palette(random8(), false, false, 0));
       SEGENV.aux1 = SEGENV.aux0;
       SEGENV.aux0 = index;
@@ -1510,7 +1510,7 @@ uint16_t WS2812FX::mode_multi_comet(void)
       }
       comets[i]++;
     } else {
-      if(!random(SEGLEN)) {
+      if(!random16(SEGLEN)) {
         comets[i] = 0;
       }
     }
@@ -1640,10 +1640,10 @@ uint16_t WS2812FX::mode_lightning(void)
     }
     SEGENV.aux1--;
 
-    SEGENV.step = millis();
+    SEGENV.step = now;
     //return random8(4, 10); // each flash only lasts one frame/every 24ms... originally 4-10 milliseconds
   } else {
-    if (millis() - SEGENV.step > SEGENV.aux0) {
+    if (now - SEGENV.step > SEGENV.aux0) {
       SEGENV.aux1--;
       if (SEGENV.aux1 < 2) SEGENV.aux1 = 0;
 
@@ -1651,7 +1651,7 @@ uint16_t WS2812FX::mode_lightning(void)
       if (SEGENV.aux1 == 2) {
         SEGENV.aux0 = (random8(255 - SEGMENT.speed) * 100); // delay between strikes
       }
-      SEGENV.step = millis();
+      SEGENV.step = now;
     }
   }
   return FRAMETIME;
@@ -1711,7 +1711,7 @@ uint16_t WS2812FX::mode_juggle(void){
   for ( byte i = 0; i < 8; i++) {
     uint16_t index = 0 + beatsin88((128 + SEGMENT.speed)*(i + 7), 0, SEGLEN -1);
     fastled_col = col_to_crgb(getPixelColor(index));
-    fastled_col |= (SEGMENT.palette==0)?CHSV(dothue, 220, 255):ColorFromPalette(currentPalette, dothue, 255);
+    fastled_col |= (SEGMENT.palette==0)?CHSV(dothue, 220, 255):ColorFromPalette(SEGPALETTE, dothue, 255);
     setPixelColor(index, fastled_col.red, fastled_col.green, fastled_col.blue);
     dothue += 32;
   }
@@ -1729,13 +1729,17 @@ uint16_t WS2812FX::mode_palette()
   }
   
   bool noWrap = (paletteBlend == 2 || (paletteBlend == 0 && SEGMENT.speed == 0));
-  for (uint16_t i = 0; i < SEGLEN; i++)
+  uint8_t colorIndex[PALETTE_SPAN];
+  for (uint16_t i = 0; i < SEGLEN; i += PALETTE_SPAN)
   {
-    uint8_t colorIndex = (i * 255 / SEGLEN) - counter;
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    palette_ramp(colorIndex, i, n, SEGLEN, -counter);
     
-    if (noWrap) colorIndex = map(colorIndex, 0, 255, 0, 240); //cut off blend at palette "end"
+    if (noWrap) { //cut off blend at palette "end"
+      for (uint16_t j = 0; j < n; j++) colorIndex[j] = map(colorIndex[j], 0, 255, 0, 240);
+    }
     
-    setPixelColor(i, color_from_palette(colorIndex, false, true, 255));
+    setPixelsFromPalette(i, n, colorIndex);
   }
   return FRAMETIME;
 }
@@ -1804,7 +1808,7 @@ uint16_t WS2812FX::mode_fire_2012()
 
   // Step 4.  Map from heat cells to LED colors
   for (uint16_t j = 0; j < SEGLEN; j++) {
-    CRGB color = ColorFromPalette(currentPalette, MIN(heat[j],240), 255, LINEARBLEND);
+    CRGB color = ColorFromPalette(SEGPALETTE, MIN(heat[j],240), 255, LINEARBLEND);
     setPixelColor(j, color.red, color.green, color.blue);
   }
   return FRAMETIME;
@@ -1832,29 +1836,33 @@ uint16_t WS2812FX::mode_colorwaves()
   sHue16 += duration * beatsin88(400, 5, 9);
   uint16_t brightnesstheta16 = sPseudotime;
   CRGB fastled_col;
+  uint8_t hue8[PALETTE_SPAN], bri8[PALETTE_SPAN];
+  uint32_t colors[PALETTE_SPAN];
+
+  for ( uint16_t i = 0 ; i < SEGLEN; i += PALETTE_SPAN) {
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    for (uint16_t j = 0; j < n; j++) {
+      uint16_t steps = samplePos(i + j) + 1;                 // hue and brightness advance once per pixel
+      uint16_t h16_128 = (uint16_t)(hue16 + hueinc16 * steps) >> 7;
+      if ( h16_128 & 0x100) {
+        hue8[j] = 255 - (h16_128 >> 1);
+      } else {
+        hue8[j] = h16_128 >> 1;
+      }
 
-  for ( uint16_t i = 0 ; i < SEGLEN; i++) {
-    hue16 += hueinc16;
-    uint8_t hue8 = hue16 >> 8;
-    uint16_t h16_128 = hue16 >> 7;
-    if ( h16_128 & 0x100) {
-      hue8 = 255 - (h16_128 >> 1);
-    } else {
-      hue8 = h16_128 >> 1;
-    }
-
-    brightnesstheta16  += brightnessthetainc16;
-    uint16_t b16 = sin16( brightnesstheta16  ) + 32768;
-
-    uint16_t bri16 = (uint32_t)((uint32_t)b16 * (uint32_t)b16) / 65536;
-    uint8_t bri8 = (uint32_t)(((uint32_t)bri16) * brightdepth) / 65536;
-    bri8 += (255 - brightdepth);
+      uint16_t b16 = sin16( (uint16_t)(brightnesstheta16 + brightnessthetainc16 * steps) ) + 32768;
 
-    CRGB newcolor = ColorFromPalette(currentPalette, hue8, bri8);
-    fastled_col = col_to_crgb(getPixelColor(i));
+      uint16_t bri16 = (uint32_t)((uint32_t)b16 * (uint32_t)b16) / 65536;
+      bri8[j] = (uint32_t)(((uint32_t)bri16) * brightdepth) / 65536;
+      bri8[j] += (255 - brightdepth);
+    }
+    colors_from_palette(hue8, bri8, colors, n);
 
-    nblend(fastled_col, newcolor, 128);
-    setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
+    for (uint16_t j = 0; j < n; j++) {
+      fastled_col = col_to_crgb(getPixelColor(i + j));
+      nblend(fastled_col, col_to_crgb(colors[j]), 128);
+      setPixelColor(i + j, fastled_col.red, fastled_col.green, fastled_col.blue);
+    }
   }
   SEGENV.step = sPseudotime;
   SEGENV.aux0 = sHue16;
@@ -1869,7 +1877,7 @@ uint16_t WS2812FX::mode_bpm()
   uint32_t stp = (now / 20) & 0xFF;
   uint8_t beat = beatsin8(SEGMENT.speed, 64, 255);
   for (uint16_t i = 0; i < SEGLEN; i++) {
-    fastled_col = ColorFromPalette(currentPalette, stp + (i * 2), beat - stp + (i * 10));
+    fastled_col = ColorFromPalette(SEGPALETTE, stp + (i * 2), beat - stp + (i * 10));
     setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
   }
   return FRAMETIME;
@@ -1879,11 +1887,13 @@ uint16_t WS2812FX::mode_bpm()
 uint16_t WS2812FX::mode_fillnoise8()
 {
   if (SEGENV.call == 0) SEGENV.step = random16(12345);
-  CRGB fastled_col;
-  for (uint16_t i = 0; i < SEGLEN; i++) {
-    uint8_t index = inoise8(i * SEGLEN, SEGENV.step + i * SEGLEN);
-    fastled_col = ColorFromPalette(currentPalette, index, 255, LINEARBLEND);
-    setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
+  uint8_t index[PALETTE_SPAN];
+  for (uint16_t i = 0; i < SEGLEN; i += PALETTE_SPAN) {
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    for (uint16_t j = 0; j < n; j++) {
+      index[j] = inoise8((i + j) * SEGLEN, SEGENV.step + (i + j) * SEGLEN);
+    }
+    setPixelsFromPalette(i, n, index);
   }
   SEGENV.step += beatsin8(SEGMENT.speed, 1, 6); //10,1,4
 
@@ -1893,25 +1903,24 @@ uint16_t WS2812FX::mode_fillnoise8()
 uint16_t WS2812FX::mode_noise16_1()
 {
   uint16_t scale = 320;                                      // the "zoom factor" for the noise
-  CRGB fastled_col;
+  uint8_t index[PALETTE_SPAN];
   SEGENV.step += (1 + SEGMENT.speed/16);
 
-  for (uint16_t i = 0; i < SEGLEN; i++) {
+  uint16_t shift_x = beatsin8(11);                           // the x position of the noise field swings @ 17 bpm
+  uint16_t shift_y = SEGENV.step/42;                         // the y position becomes slowly incremented
+  uint32_t real_z = SEGENV.step;                             // the z position becomes quickly incremented
 
-    uint16_t shift_x = beatsin8(11);                           // the x position of the noise field swings @ 17 bpm
-    uint16_t shift_y = SEGENV.step/42;             // the y position becomes slowly incremented
+  for (uint16_t i = 0; i < SEGLEN; i += PALETTE_SPAN) {
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    for (uint16_t j = 0; j < n; j++) {
+      uint16_t real_x = (samplePos(i + j) + shift_x) * scale;
+      uint16_t real_y = (samplePos(i + j) + shift_y) * scale;
 
+      uint8_t noise = inoise16(real_x, real_y, real_z) >> 8; // get the noise data and scale it down
 
-    uint16_t real_x = (i + shift_x) * scale;                  // the x position of the noise field swings @ 17 bpm
-    uint16_t real_y = (i + shift_y) * scale;                  // the y position becomes slowly incremented
-    uint32_t real_z = SEGENV.step;                          // the z position becomes quickly incremented
-
-    uint8_t noise = inoise16(real_x, real_y, real_z) >> 8;   // get the noise data and scale it down
-
-    uint8_t index = sin8(noise * 3);                         // map LED color based on noise data
-
-    fastled_col = ColorFromPalette(currentPalette, index, 255, LINEARBLEND);   // With that value, look up the 8 bit colour palette value and assign it to the current LED.
-    setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
+      index[j] = sin8(noise * 3);                            // map LED color based on noise data
+    }
+    setPixelsFromPalette(i, n, index);                       // look up the palette colors of the whole span at once
   }
 
   return FRAMETIME;
@@ -1920,23 +1929,22 @@ uint16_t WS2812FX::mode_noise16_1()
 
 uint16_t WS2812FX::mode_noise16_2()
 {
-  uint16_t scale = 1000;                                       // the "zoom factor" for the noise
-  CRGB fastled_col;
+  uint16_t scale = 1000;                                     // the "zoom factor" for the noise
+  uint8_t index[PALETTE_SPAN], noise[PALETTE_SPAN];
   SEGENV.step += (1 + (SEGMENT.speed >> 1));
 
-  for (uint16_t i = 0; i < SEGLEN; i++) {
+  uint16_t shift_x = SEGENV.step >> 6;                       // x as a function of time
 
-    uint16_t shift_x = SEGENV.step >> 6;                         // x as a function of time
-    uint16_t shift_y = SEGENV.step/42;
+  for (uint16_t i = 0; i < SEGLEN; i += PALETTE_SPAN) {
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    for (uint16_t j = 0; j < n; j++) {
+      uint32_t real_x = (samplePos(i + j) + shift_x) * scale; // calculate the coordinates within the noise field
 
-    uint32_t real_x = (i + shift_x) * scale;                  // calculate the coordinates within the noise field
+      noise[j] = inoise16(real_x, 0, 4223) >> 8;             // get the noise data and scale it down
 
-    uint8_t noise = inoise16(real_x, 0, 4223) >> 8;    // get the noise data and scale it down
-
-    uint8_t index = sin8(noise * 3);                          // map led color based on noise data
-
-    fastled_col = ColorFromPalette(currentPalette, index, noise, LINEARBLEND);   // With that value, look up the 8 bit colour palette value and assign it to the current LED.
-    setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
+      index[j] = sin8(noise[j] * 3);                         // map led color based on noise data
+    }
+    setPixelsFromPalette(i, n, index, noise);                // the noise is the brightness, too
   }
 
   return FRAMETIME;
@@ -1945,25 +1953,25 @@ uint16_t WS2812FX::mode_noise16_2()
 
 uint16_t WS2812FX::mode_noise16_3()
 {
-  uint16_t scale = 800;                                       // the "zoom factor" for the noise
-  CRGB fastled_col;
+  uint16_t scale = 800;                                      // the "zoom factor" for the noise
+  uint8_t index[PALETTE_SPAN], noise[PALETTE_SPAN];
   SEGENV.step += (1 + SEGMENT.speed);
 
-  for (uint16_t i = 0; i < SEGLEN; i++) {
+  uint16_t shift_x = 4223;                                   // no movement along x and y
+  uint16_t shift_y = 1234;
+  uint32_t real_z = SEGENV.step*8;
 
-    uint16_t shift_x = 4223;                                  // no movement along x and y
-    uint16_t shift_y = 1234;
+  for (uint16_t i = 0; i < SEGLEN; i += PALETTE_SPAN) {
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    for (uint16_t j = 0; j < n; j++) {
+      uint32_t real_x = (samplePos(i + j) + shift_x) * scale; // calculate the coordinates within the noise field
+      uint32_t real_y = (samplePos(i + j) + shift_y) * scale; // based on the precalculated positions
 
-    uint32_t real_x = (i + shift_x) * scale;                  // calculate the coordinates within the noise field
-    uint32_t real_y = (i + shift_y) * scale;                  // based on the precalculated positions
-    uint32_t real_z = SEGENV.step*8;  
+      noise[j] = inoise16(real_x, real_y, real_z) >> 8;      // get the noise data and scale it down
 
-    uint8_t noise = inoise16(real_x, real_y, real_z) >> 8;    // get the noise data and scale it down
-
-    uint8_t index = sin8(noise * 3);                          // map led color based on noise data
-
-    fastled_col = ColorFromPalette(currentPalette, index, noise, LINEARBLEND);   // With that value, look up the 8 bit colour palette value and assign it to the current LED.
-    setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
+      index[j] = sin8(noise[j] * 3);                         // map led color based on noise data
+    }
+    setPixelsFromPalette(i, n, index, noise);                // the noise is the brightness, too
   }
 
   return FRAMETIME;
@@ -1973,12 +1981,12 @@ uint16_t WS2812FX::mode_noise16_3()
 //https://github.com/aykevl/ledstrip-spark/blob/master/ledstrip.ino
 uint16_t WS2812FX::mode_noise16_4()
 {
-  CRGB fastled_col;
+  uint8_t index[PALETTE_SPAN];
   uint32_t stp = (now * SEGMENT.speed) >> 7;
-  for (uint16_t i = 0; i < SEGLEN; i++) {
-    int16_t index = inoise16(uint32_t(i) << 12, stp);
-    fastled_col = ColorFromPalette(currentPalette, index);
-    setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
+  for (uint16_t i = 0; i < SEGLEN; i += PALETTE_SPAN) {
+    uint16_t n = MIN(PALETTE_SPAN, SEGLEN - i);
+    for (uint16_t j = 0; j < n; j++) index[j] = inoise16(uint32_t(samplePos(i + j)) << 12, stp);
+    setPixelsFromPalette(i, n, index);
   }
   return FRAMETIME;
 }
@@ -2027,7 +2035,7 @@ uint16_t WS2812FX::mode_colortwinkle()
       {
         int i = random16(SEGLEN);
         if(getPixelColor(i) == 0) {
-          fastled_col = ColorFromPalette(currentPalette, random8(), 64, NOBLEND);
+          fastled_col = ColorFromPalette(SEGPALETTE, random8(), 64, NOBLEND);
           uint16_t index = i >> 3;
           uint8_t  bitNum = i & 0x07;
           bitWrite(SEGENV.data[index], bitNum, true);
@@ -2051,9 +2059,10 @@ uint16_t WS2812FX::mode_lake() {
 
   for (uint16_t i = 0; i < SEGLEN; i++)
   {
-    int index = cos8((i*15)+ wave1)/2 + cubicwave8((i*23)+ wave2)/2;           
+    uint16_t pos = samplePos(i);
+    int index = cos8((pos*15)+ wave1)/2 + cubicwave8((pos*23)+ wave2)/2;           
     uint8_t lum = (index > wave3) ? index - wave3 : 0;
-    fastled_col = ColorFromPalette(currentPalette, map(index,0,255,0,240), lum, LINEARBLEND);
+    fastled_col = ColorFromPalette(SEGPALETTE, map(index,0,255,0,240), lum, LINEARBLEND);
     setPixelColor(i, fastled_col.red, fastled_col.green, fastled_col.blue);
   }
   return FRAMETIME;
@@ -2306,7 +2315,7 @@ CRGB WS2812FX::twinklefox_one_twinkle(uint32_t ms, uint8_t salt, bool cat)
   uint8_t hue = slowcycle8 - salt;
   CRGB c;
   if (bright > 0) {
-    c = ColorFromPalette(currentPalette, hue, bright, NOBLEND);
+    c = ColorFromPalette(SEGPALETTE, hue, bright, NOBLEND);
     if(COOL_LIKE_INCANDESCENT == 1) {
       // This code takes a pixel, and if its in the 'fading down'
       // part of the cycle, it adjusts the color a little bit like the
@@ -2547,12 +2556,47 @@ uint16_t WS2812FX::mode_spots_fade()
 }
 
 
+/*
+ * Fixed point particles for the physics based effects (bouncing balls, popcorn, 1D fireworks, drip, starburst, aurora).
+ * Positions, velocities and factors are Q16.16 (16 integer and 16 fraction bits), positions in pixels.
+ * This avoids float math, which is slow on the ESP8266 without FPU, and keeps the motion of the float versions.
+ */
+typedef int32_t q16;
+#define Q16_ONE   65536
+#define Q16(x)    ((q16)((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5))) //constants only, evaluated by the compiler
+
+inline q16 q16mul(q16 a, q16 b) {
+  return ((int64_t)a * b) >> 16;
+}
+
+//integer part rounded towards zero, like a float to int conversion
+inline int32_t q16int(q16 a) {
+  return (a < 0) ? -((-a) >> 16) : (a >> 16);
+}
+
+//square root of a Q16.16 value given as 64 bit, so large products do not overflow
+q16 q16sqrt(int64_t a) {
+  if (a <= 0) return 0;
+  uint64_t x = (uint64_t)a << 16, res = 0, bit = (uint64_t)1 << 62;
+  while (bit > x) bit >>= 2;
+  while (bit) {
+    if (x >= res + bit) { x -= res + bit; res = (res >> 1) + bit; }
+    else res >>= 1;
+    bit >>= 2;
+  }
+  return res;
+}
+
+//gravity of -num/den pixels per frame^2 per pixel of segment length
+q16 q16gravity(uint32_t num, uint32_t den, uint16_t len) {
+  return -(q16)(((int64_t)num * len << 16) / den);
+}
+
 //each needs 12 bytes
-//Spark type is used for popcorn and 1D fireworks
 typedef struct Ball {
   unsigned long lastBounceTime;
-  float impactVelocity;
-  float height;
+  q16 impactVelocity;
+  q16 height;
 } ball;
 
 /*
@@ -2568,12 +2612,12 @@ uint16_t WS2812FX::mode_bouncing_balls(void) {
   
   // number of balls based on intensity setting to max of 7 (cycles colors)
   // non-chosen color is a random color
-  uint8_t numBalls = int(((SEGMENT.intensity * (maxNumBalls - 0.8f)) / 255) + 1);
+  uint8_t numBalls = ((SEGMENT.intensity * (maxNumBalls * 5 - 4)) / 1275) + 1;
   
-  float gravity                           = -9.81; // standard value of gravity
-  float impactVelocityStart               = sqrt( -2 * gravity);
+  const q16 halfGravity         = Q16(-9.81 / 2); // standard value of gravity
+  const q16 impactVelocityStart = Q16(4.4294469); // sqrt(2 * 9.81)
 
-  unsigned long time = millis();
+  unsigned long time = now;
 
   if (SEGENV.call == 0) {
     for (uint8_t i = 0; i < maxNumBalls; i++) balls[i].lastBounceTime = time;
@@ -2583,17 +2627,19 @@ uint16_t WS2812FX::mode_bouncing_balls(void) {
   fill(hasCol2 ? BLACK : SEGCOLOR(1));
   
   for (uint8_t i = 0; i < numBalls; i++) {
-    float timeSinceLastBounce = (time - balls[i].lastBounceTime)/((255-SEGMENT.speed)*8/256 +1);
-    balls[i].height = 0.5 * gravity * pow(timeSinceLastBounce/1000 , 2.0) + balls[i].impactVelocity * timeSinceLastBounce/1000;
+    int64_t timeSinceLastBounce = (time - balls[i].lastBounceTime)/((255-SEGMENT.speed)*8/256 +1);
+    if (timeSinceLastBounce > 10000) timeSinceLastBounce = 10000; //long past the next bounce, avoids overflow
+    //in ms, so 0.5 * g * t^2 + v * t needs no fractional time
+    balls[i].height = (halfGravity * timeSinceLastBounce * timeSinceLastBounce) / 1000000 + (balls[i].impactVelocity * timeSinceLastBounce) / 1000;
 
     if (balls[i].height < 0) { //start bounce
       balls[i].height = 0;
-      //damping for better effect using multiple balls
-      float dampening = 0.90 - float(i)/pow(numBalls,2);
-      balls[i].impactVelocity = dampening * balls[i].impactVelocity;
+      //damping for better effect using multiple balls, 0.9 - i / numBalls^2
+      int32_t balls2 = numBalls * numBalls;
+      balls[i].impactVelocity = ((int64_t)balls[i].impactVelocity * (9 * balls2 - 10 * i)) / (10 * balls2);
       balls[i].lastBounceTime = time;
 
-      if (balls[i].impactVelocity < 0.015) {
+      if (balls[i].impactVelocity < Q16(0.015)) {
         balls[i].impactVelocity = impactVelocityStart;
       }
     }
@@ -2605,7 +2651,7 @@ uint16_t WS2812FX::mode_bouncing_balls(void) {
       color = SEGCOLOR(i % NUM_COLORS);
     }
 
-    uint16_t pos = round(balls[i].height * (SEGLEN - 1));
+    uint16_t pos = ((int64_t)balls[i].height * (SEGLEN - 1) + (Q16_ONE >> 1)) >> 16;
     setPixelColor(pos, color);
   }
 
@@ -2680,12 +2726,18 @@ uint16_t WS2812FX::mode_glitter()
 //each needs 12 bytes
 //Spark type is used for popcorn, 1D fireworks, and drip
 typedef struct Spark {
-  float pos;
-  float vel;
+  q16 pos;
+  q16 vel;
   uint16_t col;
   uint8_t colIndex;
 } spark;
 
+//moves a spark by one frame
+inline void sparkMove(Spark* s, q16 gravity) {
+  s->pos += s->vel;
+  s->vel += gravity;
+}
+
 /*
 *  POPCORN
 *  modified from https://github.com/kitesurfer1404/WS2812FX/blob/master/src/custom/Popcorn.h
@@ -2698,8 +2750,7 @@ uint16_t WS2812FX::mode_popcorn(void) {
   
   Spark* popcorn = reinterpret_cast<Spark*>(SEGENV.data);
 
-  float gravity = -0.0001 - (SEGMENT.speed/200000.0); // m/s/s
-  gravity *= SEGLEN;
+  q16 gravity = q16gravity(20 + SEGMENT.speed, 200000, SEGLEN); // -0.0001 - speed/200000 per frame^2, times SEGLEN
 
   bool hasCol2 = SEGCOLOR(2);
   fill(hasCol2 ? BLACK : SEGCOLOR(1));
@@ -2708,23 +2759,22 @@ uint16_t WS2812FX::mode_popcorn(void) {
   if (numPopcorn == 0) numPopcorn = 1;
 
   for(uint8_t i = 0; i < numPopcorn; i++) {
-    bool isActive = popcorn[i].pos >= 0.0f;
+    bool isActive = popcorn[i].pos >= 0;
 
     if (isActive) { // if kernel is active, update its position
-      popcorn[i].pos += popcorn[i].vel;
-      popcorn[i].vel += gravity;
+      sparkMove(&popcorn[i], gravity);
       uint32_t col = color_wheel(popcorn[i].colIndex);
       if (!SEGMENT.palette && popcorn[i].colIndex < NUM_COLORS) col = SEGCOLOR(popcorn[i].colIndex);
       
-      uint16_t ledIndex = popcorn[i].pos;
-      if (ledIndex < SEGLEN) setPixelColor(ledIndex, col);
+      int32_t ledIndex = q16int(popcorn[i].pos);
+      if (ledIndex >= 0 && ledIndex < SEGLEN) setPixelColor(ledIndex, col);
     } else { // if kernel is inactive, randomly pop it
       if (random8() < 2) { // POP!!!
-        popcorn[i].pos = 0.01f;
+        popcorn[i].pos = Q16(0.01);
         
         uint16_t peakHeight = 128 + random8(128); //0-255
         peakHeight = (peakHeight * (SEGLEN -1)) >> 8;
-        popcorn[i].vel = sqrt(-2.0 * gravity * peakHeight);
+        popcorn[i].vel = q16sqrt(-2LL * gravity * peakHeight);
         
         if (SEGMENT.palette)
         {
@@ -2845,9 +2895,9 @@ typedef struct particle {
   CRGB     color;
   uint32_t birth  =0;
   uint32_t last   =0;
-  float    vel    =0;
+  q16      vel    =0; //pixels per second
   uint16_t pos    =-1;
-  float    fragment[STARBURST_MAX_FRAG];
+  q16      fragment[STARBURST_MAX_FRAG];
 } star;
 
 uint16_t WS2812FX::mode_starburst(void) {
@@ -2857,13 +2907,13 @@ uint16_t WS2812FX::mode_starburst(void) {
 
   if (!SEGENV.allocateData(dataSize)) return mode_static(); //allocation failed
   
-  uint32_t it = millis();
+  uint32_t it = now;
   
   star* stars = reinterpret_cast<star*>(SEGENV.data);
   
-  float          maxSpeed                = 375.0f;  // Max velocity
-  float          particleIgnition        = 250.0f;  // How long to "flash"
-  float          particleFadeTime        = 1500.0f; // Fade out time
+  const uint16_t maxSpeed         = 375;  // Max velocity
+  const uint16_t particleIgnition = 250;  // How long to "flash"
+  const uint16_t particleFadeTime = 1500; // Fade out time
      
   for (int j = 0; j < numStars; j++)
   {
@@ -2872,19 +2922,19 @@ uint16_t WS2812FX::mode_starburst(void) {
     {
       // Pick a random color and location.  
       uint16_t startPos = random16(SEGLEN-1);
-      float multiplier = (float)(random8())/255.0 * 1.0;
+      uint8_t multiplier = random8();
 
       stars[j].color = col_to_crgb(color_wheel(random8()));
       stars[j].pos = startPos; 
-      stars[j].vel = maxSpeed * (float)(random8())/255.0 * multiplier;
+      stars[j].vel = ((int64_t)maxSpeed * random8() * multiplier << 16) / (255 * 255);
       stars[j].birth = it;
       stars[j].last = it;
       // more fragments means larger burst effect
       int num = random8(3,6 + (SEGMENT.intensity >> 5));
 
       for (int i=0; i < STARBURST_MAX_FRAG; i++) {
-        if (i < num) stars[j].fragment[i] = startPos;
-        else stars[j].fragment[i] = -1;
+        if (i < num) stars[j].fragment[i] = (q16)startPos << 16;
+        else stars[j].fragment[i] = -Q16_ONE;
       }
     }
   }
@@ -2894,54 +2944,57 @@ uint16_t WS2812FX::mode_starburst(void) {
   for (int j=0; j<numStars; j++)
   {
     if (stars[j].birth != 0) {
-      float dt = (it-stars[j].last)/1000.0;
+      uint32_t dtMs = it-stars[j].last;
+      if (dtMs > 1000) dtMs = 1000; //paused, limit the step to keep within Q16.16 range
+      q16 dt = ((int64_t)dtMs << 16) / 1000; //seconds
+      q16 step = q16mul(stars[j].vel, dt);
 
       for (int i=0; i < STARBURST_MAX_FRAG; i++) {
         int var = i >> 1;
         
         if (stars[j].fragment[i] > 0) {
           //all fragments travel right, will be mirrored on other side
-          stars[j].fragment[i] += stars[j].vel * dt * (float)var/3.0;
+          stars[j].fragment[i] += step * var / 3;
         }
       }
       stars[j].last = it;
-      stars[j].vel -= 3*stars[j].vel*dt;
+      stars[j].vel -= q16mul(3*stars[j].vel, dt);
     }
   
     CRGB c = stars[j].color;
 
     // If the star is brand new, it flashes white briefly.  
     // Otherwise it just fades over time.
-    float fade = 0.0f;
-    float age = it-stars[j].birth;
+    q16 fade = 0;
+    uint32_t age = it-stars[j].birth;
 
     if (age < particleIgnition) {
-      c = col_to_crgb(color_blend(WHITE, crgb_to_col(c), 254.5f*((age / particleIgnition))));
+      c = col_to_crgb(color_blend(WHITE, crgb_to_col(c), (age * 509) / (2 * particleIgnition))); //254.5 * age / particleIgnition
     } else {
       // Figure out how much to fade and shrink the star based on 
       // its age relative to its lifetime
       if (age > particleIgnition + particleFadeTime) {
-        fade = 1.0f;                  // Black hole, all faded out
+        fade = Q16_ONE;               // Black hole, all faded out
         stars[j].birth = 0;
         c = col_to_crgb(SEGCOLOR(1));
       } else {
         age -= particleIgnition;
-        fade = (age / particleFadeTime);  // Fading star
-        byte f = 254.5f*fade;
+        fade = ((int64_t)age << 16) / particleFadeTime;  // Fading star
+        byte f = (age * 509) / (2 * particleFadeTime);
         c = col_to_crgb(color_blend(crgb_to_col(c), SEGCOLOR(1), f));
       }
     }
     
-    float particleSize = (1.0 - fade) * 2;
+    q16 particleSize = (Q16_ONE - fade) * 2;
 
     for (uint8_t index=0; index < STARBURST_MAX_FRAG*2; index++) {
       bool mirrored = index & 0x1;
       uint8_t i = index >> 1;
       if (stars[j].fragment[i] > 0) {
-        float loc = stars[j].fragment[i];
-        if (mirrored) loc -= (loc-stars[j].pos)*2;
-        int start = loc - particleSize;
-        int end = loc + particleSize;
+        q16 loc = stars[j].fragment[i];
+        if (mirrored) loc = ((q16)stars[j].pos << 17) - loc;
+        int start = q16int(loc - particleSize);
+        int end = q16int(loc + particleSize);
         if (start < 0) start = 0;
         if (start == end) end++;
         if (end > SEGLEN) end = SEGLEN;    
@@ -2977,15 +3030,14 @@ uint16_t WS2812FX::mode_exploding_fireworks(void)
   Spark* sparks = reinterpret_cast<Spark*>(SEGENV.data);
   Spark* flare = sparks; //first spark is flare data
 
-  float gravity = -0.0004 - (SEGMENT.speed/800000.0); // m/s/s
-  gravity *= SEGLEN;
+  q16 gravity = q16gravity(320 + SEGMENT.speed, 800000, SEGLEN); // -0.0004 - speed/800000 per frame^2, times SEGLEN
   
   if (SEGENV.aux0 < 2) { //FLARE
     if (SEGENV.aux0 == 0) { //init flare
       flare->pos = 0;
       uint16_t peakHeight = 75 + random8(180); //0-255
       peakHeight = (peakHeight * (SEGLEN -1)) >> 8;
-      flare->vel = sqrt(-2.0 * gravity * peakHeight);
+      flare->vel = q16sqrt(-2LL * gravity * peakHeight);
       flare->col = 255; //brightness
 
       SEGENV.aux0 = 1; 
@@ -2994,11 +3046,10 @@ uint16_t WS2812FX::mode_exploding_fireworks(void)
     // launch 
     if (flare->vel > 12 * gravity) {
       // flare
-      setPixelColor(int(flare->pos),flare->col,flare->col,flare->col);
+      setPixelColor(q16int(flare->pos),flare->col,flare->col,flare->col);
   
-      flare->pos += flare->vel;
-      flare->pos = constrain(flare->pos, 0, SEGLEN-1);
-      flare->vel += gravity;
+      sparkMove(flare, gravity);
+      flare->pos = constrain(flare->pos, 0, (q16)(SEGLEN-1) << 16);
       flare->col -= 2;
     } else {
       SEGENV.aux0 = 2;  // ready to explode
@@ -3010,20 +3061,20 @@ uint16_t WS2812FX::mode_exploding_fireworks(void)
      * Explosion happens where the flare ended.
      * Size is proportional to the height.
      */
-    int nSparks = flare->pos;
+    int nSparks = q16int(flare->pos);
     nSparks = constrain(nSparks, 0, numSparks);
-    static float dying_gravity;
+    static q16 dying_gravity;
   
     // initialize sparks
     if (SEGENV.aux0 == 2) {
       for (int i = 1; i < nSparks; i++) { 
         sparks[i].pos = flare->pos; 
-        sparks[i].vel = (float(random16(0, 20000)) / 10000.0) - 0.9; // from -0.9 to 1.1
+        sparks[i].vel = (((q16)random16(0, 20000) << 16) / 10000) - Q16(0.9); // from -0.9 to 1.1
         sparks[i].col = 345;//abs(sparks[i].vel * 750.0); // set colors before scaling velocity to keep them bright 
         //sparks[i].col = constrain(sparks[i].col, 0, 345); 
         sparks[i].colIndex = random8();
-        sparks[i].vel *= flare->pos/SEGLEN; // proportional to height 
-        sparks[i].vel *= -gravity *50;
+        sparks[i].vel = q16mul(sparks[i].vel, flare->pos/SEGLEN); // proportional to height 
+        sparks[i].vel = q16mul(sparks[i].vel, -gravity *50);
       } 
       //sparks[1].col = 345; // this will be our known spark 
       dying_gravity = gravity/2; 
@@ -3032,11 +3083,10 @@ uint16_t WS2812FX::mode_exploding_fireworks(void)
   
     if (sparks[1].col > 4) {//&& sparks[1].pos > 0) { // as long as our known spark is lit, work with all the sparks
       for (int i = 1; i < nSparks; i++) { 
-        sparks[i].pos += sparks[i].vel; 
-        sparks[i].vel += dying_gravity; 
+        sparkMove(&sparks[i], dying_gravity);
         if (sparks[i].col > 3) sparks[i].col -= 4; 
 
-        if (sparks[i].pos > 0 && sparks[i].pos < SEGLEN) {
+        if (sparks[i].pos > 0 && sparks[i].pos < ((q16)SEGLEN << 16)) {
           uint16_t prog = sparks[i].col;
           uint32_t spColor = (SEGMENT.palette) ? color_wheel(sparks[i].colIndex) : SEGCOLOR(0);
           CRGB c = CRGB::Black; //HeatColor(sparks[i].col);
@@ -3048,10 +3098,10 @@ uint16_t WS2812FX::mode_exploding_fireworks(void)
             c.g = qsub8(c.g, cooling);
             c.b = qsub8(c.b, cooling * 2);
           }
-          setPixelColor(int(sparks[i].pos), c.red, c.green, c.blue);
+          setPixelColor(sparks[i].pos >> 16, c.red, c.green, c.blue);
         }
       }
-      dying_gravity *= .99; // as sparks burn out they fall slower
+      dying_gravity = q16mul(dying_gravity, Q16(0.99)); // as sparks burn out they fall slower
     } else {
       SEGENV.aux0 = 6 + random8(10); //wait for this many frames
     }
@@ -3086,13 +3136,12 @@ uint16_t WS2812FX::mode_drip(void)
 
   numDrops = 1 + (SEGMENT.intensity >> 6);
 
-  float gravity = -0.001 - (SEGMENT.speed/50000.0);
-  gravity *= SEGLEN;
+  q16 gravity = q16gravity(50 + SEGMENT.speed, 50000, SEGLEN); // -0.001 - speed/50000 per frame^2, times SEGLEN
   int sourcedrop = 12;
 
   for (int j=0;j<numDrops;j++) {
     if (drops[j].colIndex == 0) { //init
-      drops[j].pos = SEGLEN-1;    // start at end
+      drops[j].pos = (q16)(SEGLEN-1) << 16; // start at end
       drops[j].vel = 0;           // speed
       drops[j].col = sourcedrop;  // brightness
       drops[j].colIndex = 1;      // drop state (0 init, 1 forming, 2 falling, 5 bouncing) 
@@ -3101,7 +3150,7 @@ uint16_t WS2812FX::mode_drip(void)
     setPixelColor(SEGLEN-1,color_blend(BLACK,SEGCOLOR(0), sourcedrop));// water source
     if (drops[j].colIndex==1) {
       if (drops[j].col>255) drops[j].col=255;
-      setPixelColor(int(drops[j].pos),color_blend(BLACK,SEGCOLOR(0),drops[j].col));
+      setPixelColor(drops[j].pos >> 16,color_blend(BLACK,SEGCOLOR(0),drops[j].col));
       
       drops[j].col += map(SEGMENT.speed, 0, 255, 1, 6); // swelling
       
@@ -3112,12 +3161,11 @@ uint16_t WS2812FX::mode_drip(void)
     }  
     if (drops[j].colIndex > 1) {           // falling
       if (drops[j].pos > 0) {              // fall until end of segment
-        drops[j].pos += drops[j].vel;
+        sparkMove(&drops[j], gravity);
         if (drops[j].pos < 0) drops[j].pos = 0;
-        drops[j].vel += gravity;
 
         for (int i=1;i<7-drops[j].colIndex;i++) { // some minor math so we don't expand bouncing droplets
-          setPixelColor(int(drops[j].pos)+i,color_blend(BLACK,SEGCOLOR(0),drops[j].col/i)); //spread pixel with fade while falling
+          setPixelColor((drops[j].pos >> 16)+i,color_blend(BLACK,SEGCOLOR(0),drops[j].col/i)); //spread pixel with fade while falling
         }
         
         if (drops[j].colIndex > 2) {       // during bounce, some water is on the floor
@@ -3153,10 +3201,11 @@ uint16_t WS2812FX::mode_plasma(void) {
   uint8_t thatPhase = beatsin8(7,-64,64);
 
   for (int i = 0; i < SEGLEN; i++) {   // For each of the LED's in the strand, set color &  brightness based on a wave as follows:
-    uint8_t colorIndex = cubicwave8((i*(1+ 3*(SEGMENT.speed >> 5)))+(thisPhase) & 0xFF)/2   // factor=23 // Create a wave and add a phase change and add another wave with its own phase change.
-                             + cos8((i*(1+ 2*(SEGMENT.speed >> 5)))+(thatPhase) & 0xFF)/2;  // factor=15 // Hey, you can even change the frequencies if you wish.
+    int pos = samplePos(i);
+    uint8_t colorIndex = cubicwave8((pos*(1+ 3*(SEGMENT.speed >> 5)))+(thisPhase) & 0xFF)/2   // factor=23 // Create a wave and add a phase change and add another wave with its own phase change.
+                             + cos8((pos*(1+ 2*(SEGMENT.speed >> 5)))+(thatPhase) & 0xFF)/2;  // factor=15 // Hey, you can even change the frequencies if you wish.
     uint8_t thisBright = qsub8(colorIndex, beatsin8(6,0, (255 - SEGMENT.intensity)|0x01 ));
-    CRGB color = ColorFromPalette(currentPalette, colorIndex, thisBright, LINEARBLEND);
+    CRGB color = ColorFromPalette(SEGPALETTE, colorIndex, thisBright, LINEARBLEND);
     setPixelColor(i, color.red, color.green, color.blue);
   }
 
@@ -3220,7 +3269,7 @@ uint16_t WS2812FX::mode_heartbeat(void) {
   bri_lower = bri_lower * 2042 / (2048 + SEGMENT.intensity);
   SEGENV.aux1 = bri_lower;
 
-  unsigned long beatTimer = millis() - SEGENV.step;
+  unsigned long beatTimer = now - SEGENV.step;
   if((beatTimer > secondBeat) && !SEGENV.aux0) { // time for the second beat?
     SEGENV.aux1 = UINT16_MAX; //full bri
     SEGENV.aux0 = 1;
@@ -3228,7 +3277,7 @@ uint16_t WS2812FX::mode_heartbeat(void) {
   if(beatTimer > msPerBeat) { // time to reset the beat timer?
     SEGENV.aux1 = UINT16_MAX; //full bri
     SEGENV.aux0 = 0;
-    SEGENV.step = millis();
+    SEGENV.step = now;
   }
 
   for (uint16_t i = 0; i < SEGLEN; i++) {
@@ -3278,9 +3327,9 @@ uint16_t WS2812FX::mode_pacifica()
       0x000E39, 0x001040, 0x001450, 0x001860, 0x001C70, 0x002080, 0x1040BF, 0x2060FF };
 
   if (SEGMENT.palette) {
-    pacifica_palette_1 = currentPalette;
-    pacifica_palette_2 = currentPalette;
-    pacifica_palette_3 = currentPalette;
+    pacifica_palette_1 = SEGPALETTE;
+    pacifica_palette_2 = SEGPALETTE;
+    pacifica_palette_3 = SEGPALETTE;
   }
 
   // Increment the four "color index start" counters, one for each wave layer.
@@ -3313,14 +3362,14 @@ uint16_t WS2812FX::mode_pacifica()
   for( uint16_t i = 0; i < SEGLEN; i++) {
     CRGB c = CRGB(2, 6, 10);
     // Render each of four layers, with different scales and speeds, that vary over time
-    c += pacifica_one_layer(i, pacifica_palette_1, sCIStart1, beatsin16(3, 11 * 256, 14 * 256), beatsin8(10, 70, 130), 0-beat16(301));
-    c += pacifica_one_layer(i, pacifica_palette_2, sCIStart2, beatsin16(4,  6 * 256,  9 * 256), beatsin8(17, 40,  80),   beat16(401));
-    c += pacifica_one_layer(i, pacifica_palette_3, sCIStart3,                         6 * 256 , beatsin8(9, 10,38)   , 0-beat16(503));
-    c += pacifica_one_layer(i, pacifica_palette_3, sCIStart4,                         5 * 256 , beatsin8(8, 10,28)   ,   beat16(601));
+    uint16_t pos = samplePos(i);
+    c += pacifica_one_layer(pos, pacifica_palette_1, sCIStart1, beatsin16(3, 11 * 256, 14 * 256), beatsin8(10, 70, 130), 0-beat16(301));
+    c += pacifica_one_layer(pos, pacifica_palette_2, sCIStart2, beatsin16(4,  6 * 256,  9 * 256), beatsin8(17, 40,  80),   beat16(401));
+    c += pacifica_one_layer(pos, pacifica_palette_3, sCIStart3,                         6 * 256 , beatsin8(9, 10,38)   , 0-beat16(503));
+    c += pacifica_one_layer(pos, pacifica_palette_3, sCIStart4,                         5 * 256 , beatsin8(8, 10,28)   ,   beat16(601));
     
     // Add extra 'white' to areas where the four layers of light have lined up brightly
-    uint8_t threshold = scale8( sin8( wave), 20) + basethreshold;
-    wave += 7;
+    uint8_t threshold = scale8( sin8( (uint8_t)(wave + 7 * pos)), 20) + basethreshold;
     uint8_t l = c.getAverageLight();
     if (l > threshold) {
       uint8_t overage = l - threshold;
@@ -3490,9 +3539,9 @@ uint16_t WS2812FX::mode_noisepal(void) {                                    // S
   CRGBPalette16* palettes = reinterpret_cast<CRGBPalette16*>(SEGENV.data);
 
   uint16_t changePaletteMs = 4000 + SEGMENT.speed *10; //between 4 - 6.5sec
-  if (millis() - SEGENV.step > changePaletteMs)
+  if (now - SEGENV.step > changePaletteMs)
   {
-    SEGENV.step = millis();
+    SEGENV.step = now;
 
     uint8_t baseI = random8();
     palettes[1] = CRGBPalette16(CHSV(baseI+random8(64), 255, random8(128,255)), CHSV(baseI+128, 255, random8(128,255)), CHSV(baseI+random8(92), 192, random8(128,255)), CHSV(baseI+random8(92), 255, random8(128,255)));
@@ -3503,7 +3552,7 @@ uint16_t WS2812FX::mode_noisepal(void) {                                    // S
   //EVERY_N_MILLIS(10) { //(don't have to time this, effect function is only called every 24ms)
   nblendPaletteTowardPalette(palettes[0], palettes[1], 48);               // Blend towards the target palette over 48 iterations.
 
-  if (SEGMENT.palette > 0) palettes[0] = currentPalette;
+  if (SEGMENT.palette > 0) palettes[0] = SEGPALETTE;
 
   for(int i = 0; i < SEGLEN; i++) {
     uint8_t index = inoise8(i*scale, SEGENV.aux0+i*scale);                // Get a value from the noise function. I'm using both x and y axis.
@@ -3634,7 +3683,7 @@ uint16_t WS2812FX::mode_dancing_shadows(void)
 
   fill(BLACK);
 
-  unsigned long time = millis();
+  unsigned long time = now;
   bool respawn = false;
 
   for (uint8_t i = 0; i < numSpotlights; i++) {
@@ -3809,7 +3858,7 @@ uint16_t WS2812FX::mode_tv_simulator(void) {
 
   // initialize start of the TV-Colors
   if (SEGENV.call == 0) { 
-    tvSimulator->pixelNum = ((uint8_t)random(18)) * numTVPixels / 18; // Begin at random movie (18 in total)
+    tvSimulator->pixelNum = ((uint8_t)random16(18)) * numTVPixels / 18; // Begin at random movie (18 in total)
   }
 
   // Read next 16-bit (5/6/5) color
@@ -3834,15 +3883,15 @@ uint16_t WS2812FX::mode_tv_simulator(void) {
     if (tvSimulator->pixelNum >= numTVPixels) tvSimulator->pixelNum = 0;
 
     // randomize total duration and fade duration for the actual color
-    tvSimulator->totalTime = random(250, 2500);                   // Semi-random pixel-to-pixel time
-    tvSimulator->fadeTime  = random(0, tvSimulator->totalTime);   // Pixel-to-pixel transition time
-    if (random(10) < 3) tvSimulator->fadeTime = 0;                // Force scene cut 30% of time
+    tvSimulator->totalTime = random16(250, 2500);                   // Semi-random pixel-to-pixel time
+    tvSimulator->fadeTime  = random16(0, tvSimulator->totalTime);   // Pixel-to-pixel transition time
+    if (random16(10) < 3) tvSimulator->fadeTime = 0;                // Force scene cut 30% of time
 
-    tvSimulator->startTime = millis();
+    tvSimulator->startTime = now;
   } // end of initialization
 
   // how much time is elapsed ?
-  tvSimulator->elapsed = millis() - tvSimulator->startTime;
+  tvSimulator->elapsed = now - tvSimulator->startTime;
 
   // fade from prev volor to next color
   if (tvSimulator->elapsed < tvSimulator->fadeTime) {
@@ -3886,53 +3935,55 @@ class AuroraWave {
   private:
     uint16_t ttl;
     CRGB basecolor;
-    float basealpha;
+    q16 basealpha;
     uint16_t age;
     uint16_t width;
-    float center;
+    q16 center;
     bool goingleft;
-    float speed_factor;
+    q16 speed_factor;
     bool alive = true;
 
   public:
     void init(uint32_t segment_length, CRGB color) {
-      ttl = random(500, 1501);
+      ttl = random16(500, 1501);
       basecolor = color;
-      basealpha = random(60, 101) / (float)100;
+      basealpha = (random16(60, 101) << 16) / 100;
       age = 0;
-      width = random(segment_length / 20, segment_length / W_WIDTH_FACTOR); //half of width to make math easier
+      width = random16(segment_length / 20, segment_length / W_WIDTH_FACTOR); //half of width to make math easier
       if (!width) width = 1;
-      center = random(101) / (float)100 * segment_length;
-      goingleft = random(0, 2) == 0;
-      speed_factor = (random(10, 31) / (float)100 * W_MAX_SPEED / 255);
+      center = ((int64_t)random16(101) * segment_length << 16) / 100;
+      goingleft = random16(0, 2) == 0;
+      speed_factor = ((int64_t)random16(10, 31) * W_MAX_SPEED << 16) / (100 * 255);
       alive = true;
     }
 
     CRGB getColorForLED(int ledIndex) {      
-      if(ledIndex < center - width || ledIndex > center + width) return 0; //Position out of range of this wave
+      q16 pos = (q16)ledIndex << 16;
+      q16 w = (q16)width << 16;
+      if(pos < center - w || pos > center + w) return 0; //Position out of range of this wave
 
       CRGB rgb;
 
       //Offset of this led from center of wave
       //The further away from the center, the dimmer the LED
-      float offset = ledIndex - center;
+      q16 offset = pos - center;
       if (offset < 0) offset = -offset;
-      float offsetFactor = offset / width;
+      q16 offsetFactor = offset / width;
 
       //The age of the wave determines it brightness.
       //At half its maximum age it will be the brightest.
-      float ageFactor = 0.1;        
-      if((float)age / ttl < 0.5) {
-        ageFactor = (float)age / (ttl / 2);
+      q16 ageFactor;
+      if(2 * age < ttl) {
+        ageFactor = ((q16)age << 16) / (ttl / 2);
       } else {
-        ageFactor = (float)(ttl - age) / ((float)ttl * 0.5);
+        ageFactor = ((q16)(ttl - age) << 17) / ttl;
       }
 
       //Calculate color based on above factors and basealpha value
-      float factor = (1 - offsetFactor) * ageFactor * basealpha;
-      rgb.r = basecolor.r * factor;
-      rgb.g = basecolor.g * factor;
-      rgb.b = basecolor.b * factor;
+      q16 factor = q16mul(q16mul(Q16_ONE - offsetFactor, ageFactor), basealpha);
+      rgb.r = (basecolor.r * factor) >> 16;
+      rgb.g = (basecolor.g * factor) >> 16;
+      rgb.b = (basecolor.b * factor) >> 16;
     
       return rgb;
     };
@@ -3952,11 +4003,11 @@ class AuroraWave {
         alive = false;
       } else {
         if(goingleft) {
-          if(center + width < 0) {
+          if(center + ((q16)width << 16) < 0) {
             alive = false;
           }
         } else {
-          if(center - width > segment_length) {
+          if(center - ((q16)width << 16) > ((q16)segment_length << 16)) {
             alive = false;
           }
         }
@@ -3976,7 +4027,7 @@ uint16_t WS2812FX::mode_aurora(void) {
 
   if(SEGENV.aux0 != SEGMENT.intensity || SEGENV.call == 0) {
     //Intensity slider changed or first call
-    SEGENV.aux1 = ((float)SEGMENT.intensity / 255) * W_MAX_COUNT;
+    SEGENV.aux1 = (SEGMENT.intensity * W_MAX_COUNT) / 255;
     SEGENV.aux0 = SEGMENT.intensity;
 
     if(!SEGENV.allocateData(sizeof(AuroraWave) * SEGENV.aux1)) {
@@ -3986,7 +4037,7 @@ uint16_t WS2812FX::mode_aurora(void) {
     waves = reinterpret_cast<AuroraWave*>(SEGENV.data);
 
     for(int i = 0; i < SEGENV.aux1; i++) {
-      waves[i].init(SEGLEN, col_to_crgb(color_from_palette(random8(), false, false, random(0, 3))));
+      waves[i].init(SEGLEN, col_to_crgb(color_from_palette(random8(), false, false, random16(0, 3))));
     }
   } else {
     waves = reinterpret_cast<AuroraWave*>(SEGENV.data);
@@ -3998,7 +4049,7 @@ uint16_t WS2812FX::mode_aurora(void) {
 
     if(!(waves[i].stillAlive())) {
       //If a wave dies, reinitialize it starts over.
-      waves[i].init(SEGLEN, col_to_crgb(color_from_palette(random8(), false, false, random(0, 3))));
+      waves[i].init(SEGLEN, col_to_crgb(color_from_palette(random8(), false, false, random16(0, 3))));
     }
   }
 
@@ -4020,4 +4071,89 @@ uint16_t WS2812FX::mode_aurora(void) {
   }
   
   return FRAMETIME;
-}
\ No newline at end of file
+}
+
+
+/*
+ * Noise 2D. Perlin noise field over the matrix, moving with speed. Intensity zooms out
+ */
+uint16_t WS2812FX::mode_2D_noise(void)
+{
+  uint8_t index[MAX_MATRIX_DIM];
+  uint32_t colors[MAX_MATRIX_DIM];
+  uint16_t scale = 16 + SEGMENT.intensity;                    // distance between pixels in the noise field
+  uint16_t z = (now * (SEGMENT.speed +1)) >> 6;
+
+  for (uint16_t y = 0; y < SEGH; y++) {
+    for (uint16_t x = 0; x < SEGW; x++) index[x] = inoise8(x * scale, y * scale, z);
+    colors_from_palette(index, nullptr, colors, SEGW);       // a whole row at once
+    setRow(y, colors);
+  }
+  return FRAMETIME;
+}
+
+
+/*
+ * Matrix Rain 2D. Drops of the primary color fall down the columns and leave a trail that fades to the secondary color.
+ * Speed is the falling speed, intensity the number of drops
+ */
+uint16_t WS2812FX::mode_2D_matrix_rain(void)
+{
+  if (SEGENV.call == 0) fill(SEGCOLOR(1));
+  uint32_t cycleTime = 20 + ((255 - SEGMENT.speed) << 1);
+  uint32_t it = now / cycleTime;
+  if (it == SEGENV.step) return FRAMETIME;
+  SEGENV.step = it;
+
+  uint32_t row[MAX_MATRIX_DIM];
+  getRow(0, row);
+  shift2D(0, 1);                                               // everything falls one row
+  for (uint16_t x = 0; x < SEGW; x++) {
+    row[x] = color_blend(row[x], SEGCOLOR(1), 64);             // the top row stays and fades, which draws the trails
+    if (random8() <= (SEGMENT.intensity >> 3)) row[x] = SEGCOLOR(0); // new drop
+  }
+  setRow(0, row);
+  return FRAMETIME;
+}
+
+
+/*
+ * Lissajous 2D. A Lissajous figure from the palette that slowly changes its shape, with blurred trails.
+ * Speed is how fast it changes, intensity the length of the trails
+ */
+uint16_t WS2812FX::mode_2D_lissajous(void)
+{
+  fade_out(255 - SEGMENT.intensity);
+  uint8_t phase = (now * (SEGMENT.speed +1)) >> 13;
+
+  for (uint16_t i = 0; i < 256; i += 4) {                      // 64 points along the figure
+    uint8_t a = i;
+    uint16_t x = (sin8(3 * a + phase) * SEGW) >> 8;
+    uint16_t y = (cos8(2 * a) * SEGH) >> 8;
+    setPixelColorXY(x, y, color_from_palette(a, false, PALETTE_SOLID_WRAP, 0));
+  }
+  blur2D(32);
+  return FRAMETIME;
+}
+
+
+/*
+ * Effect table, generated from WLED_EFFECTS in FX.h and kept in flash
+ */
+#define FX_NAME(id, fn, name, pal, data, flags)  static const char _fxName_##fn[] PROGMEM = name;
+#define FX_ENTRY(id, fn, name, pal, data, flags) {&WS2812FX::fn, nullptr, _fxName_##fn, pal, data, flags},
+#define FX_ID(id, fn, name, pal, data, flags)    id,
+
+WLED_EFFECTS(FX_NAME)
+
+const WS2812FX::effect_entry WS2812FX::_effects[MODE_COUNT] PROGMEM = {
+  WLED_EFFECTS(FX_ENTRY)
+};
+
+//the table is indexed by effect id
+static constexpr uint8_t _fxIds[] = { WLED_EFFECTS(FX_ID) };
+static constexpr bool fxIdsInOrder(uint8_t i) {
+  return i >= MODE_COUNT || (_fxIds[i] == i && fxIdsInOrder(i +1));
+}
+static_assert(sizeof(_fxIds) == MODE_COUNT, "WLED_EFFECTS must list MODE_COUNT effects");
+static_assert(fxIdsInOrder(0), "WLED_EFFECTS must be in the order of the effect ids");
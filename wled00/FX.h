@@ -55,9 +55,11 @@
 /* Disable effects with high flash memory usage (currently TV simulator) - saves 18.5kB */
 //#define WLED_DISABLE_FX_HIGH_FLASH_USE
 
-/* Not used in all effects yet */
+/* Default target frame rate, can be set with setTargetFps() and lowered per segment */
 #define WLED_FPS         42
-#define FRAMETIME        (1000/WLED_FPS)
+#define WLED_FPS_MAX     250
+/* Frame time of the segment that is rendered, in ms. Only valid in effect functions */
+#define FRAMETIME        _frametime
 
 /* each segment uses 52 bytes of SRAM memory, so if you're application fails because of
   insufficient memory, decreasing MAX_NUM_SEGMENTS may help */
@@ -65,22 +67,35 @@
   #define MAX_NUM_SEGMENTS    12
   /* How many color transitions can run at once */
   #define MAX_NUM_TRANSITIONS  8
-  /* How much data bytes all segments combined may allocate */
+  /* How many effect crossfades can run at once */
+  #define MAX_NUM_MODE_TRANSITIONS 2
+  /* How much data bytes all segments combined may allocate (size of the segment data arena) */
   #define MAX_SEGMENT_DATA  2048
 #else
   #define MAX_NUM_SEGMENTS    16
   #define MAX_NUM_TRANSITIONS 16
+  #define MAX_NUM_MODE_TRANSITIONS 4
   #define MAX_SEGMENT_DATA  8192
 #endif
 
+/* How many effects usermods can add with addEffect() */
+#define MAX_USERMOD_EFFECTS 8
+
+/* Longest row or column of a 2D segment, 2D functions buffer a row or column on the stack */
+#define MAX_MATRIX_DIM    128
+
 #define LED_SKIP_AMOUNT  1
-#define MIN_SHOW_DELAY  15
+#define MIN_SHOW_DELAY  15 /* ms between shows at WLED_FPS, scales with the target frame rate */
+#define PALETTE_SPAN    32 /* pixels per batch of palette colors, effects keep index arrays of this size on the stack */
 
 #define NUM_COLORS       3 /* number of colors per segment */
 #define SEGMENT          _segments[_segment_index]
 #define SEGCOLOR(x)      _colors_t[x]
 #define SEGENV           _segment_runtimes[_segment_index]
 #define SEGLEN           _virtualSegmentLength
+#define SEGW             _segmentWidth  /* columns and rows of the segment for 2D functions, a 1D segment is wrapped into rows */
+#define SEGH             _segmentHeight
+#define SEGPALETTE       _segment_palettes[_segment_index].current
 #define SEGACT           SEGMENT.stop
 #define SPEED_FORMULA_L  5 + (50*(255 - SEGMENT.speed))/SEGLEN
 #define RESET_RUNTIME    memset(_segment_runtimes, 0, sizeof(_segment_runtimes))
@@ -118,7 +133,20 @@
 #define IS_REVERSE      ((SEGMENT.options & REVERSE     ) == REVERSE     )
 #define IS_SELECTED     ((SEGMENT.options & SELECTED    ) == SELECTED    )
 
-#define MODE_COUNT  118
+// matrix layout of 2D segments
+// bits 1-2: rotation of the mounted panel in 90 degree steps, clockwise
+// bit    0: serpentine, every other row runs in the opposite direction
+#define MATRIX_SERPENTINE  (uint8_t)0x01
+#define MATRIX_ROTATION(m) (((m) >> 1) & 0x03)
+
+#define MODE_COUNT  121
+
+// effect flags (effect table)
+#define FX_FLAG_OWN_CALLS   0x01 //the effect advances SEGENV.call itself
+#define FX_FLAG_SCALABLE    0x02 //the effect can render every Nth pixel only (segment render scale), positions from samplePos()
+
+/* Largest segment render scale */
+#define MAX_RENDER_SCALE    16
 
 #define FX_MODE_STATIC                   0
 #define FX_MODE_BLINK                    1
@@ -238,6 +266,9 @@
 #define FX_MODE_BLENDS                 115
 #define FX_MODE_TV_SIMULATOR           116
 #define FX_MODE_DYNAMIC_SMOOTH         117
+#define FX_MODE_2D_NOISE               118
+#define FX_MODE_2D_MATRIX_RAIN         119
+#define FX_MODE_2D_LISSAJOUS           120
 
 
 class WS2812FX {
@@ -250,7 +281,7 @@ class WS2812FX {
   
   // segment parameters
   public:
-    typedef struct Segment { // 24 bytes
+    typedef struct Segment { // 32 bytes
       uint16_t start;
       uint16_t stop; //segment invalid if stop == 0
       uint8_t speed;
@@ -260,6 +291,10 @@ class WS2812FX {
       uint8_t options; //bit pattern: msb first: transitional needspixelstate tbd tbd (paused) on reverse selected
       uint8_t grouping, spacing;
       uint8_t opacity;
+      uint8_t fps; //target frame rate, 0 to use the global one. Can not exceed it
+      uint8_t scale; //render scale, effects that support it compute every scale-th pixel and the rest is interpolated. 0 or 1 for all pixels
+      uint16_t width; //columns of a 2D segment (matrix), 0 for a 1D segment
+      uint8_t matrix; //layout of a 2D segment, see MATRIX_SERPENTINE and MATRIX_ROTATION
       uint32_t colors[NUM_COLORS];
       bool setColor(uint8_t slot, uint32_t c, uint8_t segn) { //returns true if changed
         if (slot >= NUM_COLORS || segn >= MAX_NUM_SEGMENTS) return false;
@@ -334,21 +369,22 @@ class WS2812FX {
       uint16_t aux0;
       uint16_t aux1;
       byte* data = nullptr;
+      // data is in the segment data arena and may be moved by compaction between effect calls, do not keep pointers to it
       bool allocateData(uint16_t len){
+        if (len > MAX_SEGMENT_DATA) return false;
+        len = (len + 3) & ~3; //4 byte aligned, effects keep structs in their data
+        if (len == 0) len = 4;  //every block needs an address of its own
         if (data && _dataLen == len) return true; //already allocated
         deallocateData();
-        if (WS2812FX::instance->_usedSegmentData + len > MAX_SEGMENT_DATA) return false; //not enough memory
-        data = new (std::nothrow) byte[len];
-        if (!data) return false; //allocation failed
-        WS2812FX::instance->_usedSegmentData += len;
+        data = WS2812FX::instance->allocateSegmentData(len);
+        if (!data) return false; //not enough memory
         _dataLen = len;
         memset(data, 0, len);
         return true;
       }
       void deallocateData(){
-        delete[] data;
+        if (data) WS2812FX::instance->freeSegmentData(data, _dataLen);
         data = nullptr;
-        WS2812FX::instance->_usedSegmentData -= _dataLen;
         _dataLen = 0;
       }
 
@@ -376,8 +412,41 @@ class WS2812FX {
       private:
         uint16_t _dataLen = 0;
         bool _requiresReset = false;
+        friend class WS2812FX;
     } segment_runtime;
 
+  // per segment palette, only rebuilt if the palette or the colors it is made from change
+    typedef struct Segment_palette { // 120 bytes
+      CRGBPalette16 current;        // used by the effect, blended towards target if palette fade is enabled
+      CRGBPalette16 target;
+      CRGB* lut = nullptr;          // current expanded to 256 colors on first use, heap allocated
+      uint32_t colors[3];           // segment colors target was made from (palettes 2-5)
+      uint32_t lastChange = 0;      // random palette timer
+      uint8_t index = 255;          // palette target was made from, 255 if none yet
+      uint8_t lutBlend = 0;         // paletteBlend the LUT was expanded with
+      bool lutValid = false;
+      bool fading = false;
+      void freeLUT() {
+        free(lut);
+        lut = nullptr;
+        lutValid = false;
+      }
+    } segment_palette;
+
+  // XY map of a 2D segment, only rebuilt if the segment or its layout changes
+    typedef struct Segment_matrix { // 16 bytes
+      uint16_t* map = nullptr;      // logical x,y to segment pixel, row by row, heap allocated
+      uint16_t cols = 0, rows = 0;  // logical size, rotation swaps width and height
+      uint16_t length = 0;          // segment length the map was built for
+      uint16_t width = 0;
+      uint8_t layout = 0;
+      void freeMap() {
+        free(map);
+        map = nullptr;
+        cols = rows = length = 0;
+      }
+    } segment_matrix;
+
     typedef struct ColorTransition { // 12 bytes
       uint32_t colorOld = 0;
       uint32_t transitionStart;
@@ -456,131 +525,29 @@ class WS2812FX {
       }
     } color_transition;
 
+  // effect crossfade, the outgoing effect keeps running for the transition time and is blended with the new one
+    typedef struct ModeTransition { // 64 bytes
+      Segment_runtime runtime;      // state of the outgoing effect, its data stays in the segment data arena
+      Segment_runtime frame;        // frame.data holds the last frame of the outgoing effect, 4 bytes per pixel
+      uint32_t transitionStart;
+      uint16_t transitionDur;
+      uint8_t mode;                 // outgoing effect
+      uint8_t segment = 0xFF;       // 0xFF if not in use
+    } mode_transition;
+
+  // effect table entry. Built-in effects are a table in flash generated from WLED_EFFECTS, usermods can add more with addEffect()
+    typedef struct EffectEntry {
+      mode_ptr fn;                  // built-in effect
+      uint16_t (*ext)(void);        // usermod effect, used if fn is null
+      const char* name;             // PROGMEM
+      uint8_t palette;              // palette used for the "Default" palette
+      uint8_t data;                 // segment data the effect allocates, in bytes per LED
+      uint8_t flags;
+    } effect_entry;
+
     WS2812FX() {
       WS2812FX::instance = this;
-      //assign each member of the _mode[] array to its respective function reference 
-      _mode[FX_MODE_STATIC]                  = &WS2812FX::mode_static;
-      _mode[FX_MODE_BLINK]                   = &WS2812FX::mode_blink;
-      _mode[FX_MODE_COLOR_WIPE]              = &WS2812FX::mode_color_wipe;
-      _mode[FX_MODE_COLOR_WIPE_RANDOM]       = &WS2812FX::mode_color_wipe_random;
-      _mode[FX_MODE_RANDOM_COLOR]            = &WS2812FX::mode_random_color;
-      _mode[FX_MODE_COLOR_SWEEP]             = &WS2812FX::mode_color_sweep;
-      _mode[FX_MODE_DYNAMIC]                 = &WS2812FX::mode_dynamic;
-      _mode[FX_MODE_RAINBOW]                 = &WS2812FX::mode_rainbow;
-      _mode[FX_MODE_RAINBOW_CYCLE]           = &WS2812FX::mode_rainbow_cycle;
-      _mode[FX_MODE_SCAN]                    = &WS2812FX::mode_scan;
-      _mode[FX_MODE_DUAL_SCAN]               = &WS2812FX::mode_dual_scan;
-      _mode[FX_MODE_FADE]                    = &WS2812FX::mode_fade;
-      _mode[FX_MODE_THEATER_CHASE]           = &WS2812FX::mode_theater_chase;
-      _mode[FX_MODE_THEATER_CHASE_RAINBOW]   = &WS2812FX::mode_theater_chase_rainbow;
-      _mode[FX_MODE_SAW]                     = &WS2812FX::mode_saw;
-      _mode[FX_MODE_TWINKLE]                 = &WS2812FX::mode_twinkle;
-      _mode[FX_MODE_DISSOLVE]                = &WS2812FX::mode_dissolve;
-      _mode[FX_MODE_DISSOLVE_RANDOM]         = &WS2812FX::mode_dissolve_random;
-      _mode[FX_MODE_SPARKLE]                 = &WS2812FX::mode_sparkle;
-      _mode[FX_MODE_FLASH_SPARKLE]           = &WS2812FX::mode_flash_sparkle;
-      _mode[FX_MODE_HYPER_SPARKLE]           = &WS2812FX::mode_hyper_sparkle;
-      _mode[FX_MODE_STROBE]                  = &WS2812FX::mode_strobe;
-      _mode[FX_MODE_STROBE_RAINBOW]          = &WS2812FX::mode_strobe_rainbow;
-      _mode[FX_MODE_MULTI_STROBE]            = &WS2812FX::mode_multi_strobe;
-      _mode[FX_MODE_BLINK_RAINBOW]           = &WS2812FX::mode_blink_rainbow;
-      _mode[FX_MODE_ANDROID]                 = &WS2812FX::mode_android;
-      _mode[FX_MODE_CHASE_COLOR]             = &WS2812FX::mode_chase_color;
-      _mode[FX_MODE_CHASE_RANDOM]            = &WS2812FX::mode_chase_random;
-      _mode[FX_MODE_CHASE_RAINBOW]           = &WS2812FX::mode_chase_rainbow;
-      _mode[FX_MODE_CHASE_FLASH]             = &WS2812FX::mode_chase_flash;
-      _mode[FX_MODE_CHASE_FLASH_RANDOM]      = &WS2812FX::mode_chase_flash_random;
-      _mode[FX_MODE_CHASE_RAINBOW_WHITE]     = &WS2812FX::mode_chase_rainbow_white;
-      _mode[FX_MODE_COLORFUL]                = &WS2812FX::mode_colorful;
-      _mode[FX_MODE_TRAFFIC_LIGHT]           = &WS2812FX::mode_traffic_light;
-      _mode[FX_MODE_COLOR_SWEEP_RANDOM]      = &WS2812FX::mode_color_sweep_random;
-      _mode[FX_MODE_RUNNING_COLOR]           = &WS2812FX::mode_running_color;
-      _mode[FX_MODE_AURORA]                  = &WS2812FX::mode_aurora;
-      _mode[FX_MODE_RUNNING_RANDOM]          = &WS2812FX::mode_running_random;
-      _mode[FX_MODE_LARSON_SCANNER]          = &WS2812FX::mode_larson_scanner;
-      _mode[FX_MODE_COMET]                   = &WS2812FX::mode_comet;
-      _mode[FX_MODE_FIREWORKS]               = &WS2812FX::mode_fireworks;
-      _mode[FX_MODE_RAIN]                    = &WS2812FX::mode_rain;
-      _mode[FX_MODE_MERRY_CHRISTMAS]         = &WS2812FX::mode_merry_christmas;
-      _mode[FX_MODE_FIRE_FLICKER]            = &WS2812FX::mode_fire_flicker;
-      _mode[FX_MODE_GRADIENT]                = &WS2812FX::mode_gradient;
-      _mode[FX_MODE_LOADING]                 = &WS2812FX::mode_loading;
-      _mode[FX_MODE_POLICE]                  = &WS2812FX::mode_police;
-      _mode[FX_MODE_POLICE_ALL]              = &WS2812FX::mode_police_all;
-      _mode[FX_MODE_TWO_DOTS]                = &WS2812FX::mode_two_dots;
-      _mode[FX_MODE_TWO_AREAS]               = &WS2812FX::mode_two_areas;
-      _mode[FX_MODE_CIRCUS_COMBUSTUS]        = &WS2812FX::mode_circus_combustus;
-      _mode[FX_MODE_HALLOWEEN]               = &WS2812FX::mode_halloween;
-      _mode[FX_MODE_TRICOLOR_CHASE]          = &WS2812FX::mode_tricolor_chase;
-      _mode[FX_MODE_TRICOLOR_WIPE]           = &WS2812FX::mode_tricolor_wipe;
-      _mode[FX_MODE_TRICOLOR_FADE]           = &WS2812FX::mode_tricolor_fade;
-      _mode[FX_MODE_BREATH]                  = &WS2812FX::mode_breath;
-      _mode[FX_MODE_RUNNING_LIGHTS]          = &WS2812FX::mode_running_lights;
-      _mode[FX_MODE_LIGHTNING]               = &WS2812FX::mode_lightning;
-      _mode[FX_MODE_ICU]                     = &WS2812FX::mode_icu;
-      _mode[FX_MODE_MULTI_COMET]             = &WS2812FX::mode_multi_comet;
-      _mode[FX_MODE_DUAL_LARSON_SCANNER]     = &WS2812FX::mode_dual_larson_scanner;
-      _mode[FX_MODE_RANDOM_CHASE]            = &WS2812FX::mode_random_chase;
-      _mode[FX_MODE_OSCILLATE]               = &WS2812FX::mode_oscillate;
-      _mode[FX_MODE_FIRE_2012]               = &WS2812FX::mode_fire_2012;
-      _mode[FX_MODE_PRIDE_2015]              = &WS2812FX::mode_pride_2015;
-      _mode[FX_MODE_BPM]                     = &WS2812FX::mode_bpm;
-      _mode[FX_MODE_JUGGLE]                  = &WS2812FX::mode_juggle;
-      _mode[FX_MODE_PALETTE]                 = &WS2812FX::mode_palette;
-      _mode[FX_MODE_COLORWAVES]              = &WS2812FX::mode_colorwaves;
-      _mode[FX_MODE_FILLNOISE8]              = &WS2812FX::mode_fillnoise8;
-      _mode[FX_MODE_NOISE16_1]               = &WS2812FX::mode_noise16_1;
-      _mode[FX_MODE_NOISE16_2]               = &WS2812FX::mode_noise16_2;
-      _mode[FX_MODE_NOISE16_3]               = &WS2812FX::mode_noise16_3;
-      _mode[FX_MODE_NOISE16_4]               = &WS2812FX::mode_noise16_4;
-      _mode[FX_MODE_COLORTWINKLE]            = &WS2812FX::mode_colortwinkle;
-      _mode[FX_MODE_LAKE]                    = &WS2812FX::mode_lake;
-      _mode[FX_MODE_METEOR]                  = &WS2812FX::mode_meteor;
-      _mode[FX_MODE_METEOR_SMOOTH]           = &WS2812FX::mode_meteor_smooth;
-      _mode[FX_MODE_RAILWAY]                 = &WS2812FX::mode_railway;
-      _mode[FX_MODE_RIPPLE]                  = &WS2812FX::mode_ripple;
-      _mode[FX_MODE_TWINKLEFOX]              = &WS2812FX::mode_twinklefox;
-      _mode[FX_MODE_TWINKLECAT]              = &WS2812FX::mode_twinklecat;
-      _mode[FX_MODE_HALLOWEEN_EYES]          = &WS2812FX::mode_halloween_eyes;
-      _mode[FX_MODE_STATIC_PATTERN]          = &WS2812FX::mode_static_pattern;
-      _mode[FX_MODE_TRI_STATIC_PATTERN]      = &WS2812FX::mode_tri_static_pattern;
-      _mode[FX_MODE_SPOTS]                   = &WS2812FX::mode_spots;
-      _mode[FX_MODE_SPOTS_FADE]              = &WS2812FX::mode_spots_fade;
-      _mode[FX_MODE_GLITTER]                 = &WS2812FX::mode_glitter;
-      _mode[FX_MODE_CANDLE]                  = &WS2812FX::mode_candle;
-      _mode[FX_MODE_STARBURST]               = &WS2812FX::mode_starburst;
-      _mode[FX_MODE_EXPLODING_FIREWORKS]     = &WS2812FX::mode_exploding_fireworks;
-      _mode[FX_MODE_BOUNCINGBALLS]           = &WS2812FX::mode_bouncing_balls;
-      _mode[FX_MODE_SINELON]                 = &WS2812FX::mode_sinelon;
-      _mode[FX_MODE_SINELON_DUAL]            = &WS2812FX::mode_sinelon_dual;
-      _mode[FX_MODE_SINELON_RAINBOW]         = &WS2812FX::mode_sinelon_rainbow;
-      _mode[FX_MODE_POPCORN]                 = &WS2812FX::mode_popcorn;
-      _mode[FX_MODE_DRIP]                    = &WS2812FX::mode_drip;
-      _mode[FX_MODE_PLASMA]                  = &WS2812FX::mode_plasma;
-      _mode[FX_MODE_PERCENT]                 = &WS2812FX::mode_percent;
-      _mode[FX_MODE_RIPPLE_RAINBOW]          = &WS2812FX::mode_ripple_rainbow;
-      _mode[FX_MODE_HEARTBEAT]               = &WS2812FX::mode_heartbeat;
-      _mode[FX_MODE_PACIFICA]                = &WS2812FX::mode_pacifica;
-      _mode[FX_MODE_CANDLE_MULTI]            = &WS2812FX::mode_candle_multi;
-      _mode[FX_MODE_SOLID_GLITTER]           = &WS2812FX::mode_solid_glitter;
-      _mode[FX_MODE_SUNRISE]                 = &WS2812FX::mode_sunrise;
-      _mode[FX_MODE_PHASED]                  = &WS2812FX::mode_phased;
-      _mode[FX_MODE_TWINKLEUP]               = &WS2812FX::mode_twinkleup;
-      _mode[FX_MODE_NOISEPAL]                = &WS2812FX::mode_noisepal;
-      _mode[FX_MODE_SINEWAVE]                = &WS2812FX::mode_sinewave;
-      _mode[FX_MODE_PHASEDNOISE]             = &WS2812FX::mode_phased_noise;
-      _mode[FX_MODE_FLOW]                    = &WS2812FX::mode_flow;
-      _mode[FX_MODE_CHUNCHUN]                = &WS2812FX::mode_chunchun;
-      _mode[FX_MODE_DANCING_SHADOWS]         = &WS2812FX::mode_dancing_shadows;
-      _mode[FX_MODE_WASHING_MACHINE]         = &WS2812FX::mode_washing_machine;
-      _mode[FX_MODE_CANDY_CANE]              = &WS2812FX::mode_candy_cane;
-      _mode[FX_MODE_BLENDS]                  = &WS2812FX::mode_blends;
-      _mode[FX_MODE_TV_SIMULATOR]            = &WS2812FX::mode_tv_simulator;
-      _mode[FX_MODE_DYNAMIC_SMOOTH]          = &WS2812FX::mode_dynamic_smooth;
-
       _brightness = DEFAULT_BRIGHTNESS;
-      currentPalette = CRGBPalette16(CRGB::Black);
-      targetPalette = CloudColors_p;
       ablMilliampsMax = 850;
       currentMilliamps = 0;
       timebase = 0;
@@ -608,13 +575,31 @@ class WS2812FX {
       resetSegments(),
       setPixelColor(uint16_t n, uint32_t c),
       setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0),
+      colors_from_palette(const uint8_t* index, const uint8_t* bri, uint32_t* colors, uint16_t count, uint8_t mcol = 255),
+      setPixelsFromPalette(uint16_t first, uint16_t count, const uint8_t* index, const uint8_t* bri = nullptr, uint8_t mcol = 255),
+      palette_ramp(uint8_t* index, uint16_t first, uint16_t count, uint16_t len, uint8_t offset = 0),
       show(void),
       setRgbwPwm(void),
       setColorOrder(uint8_t co),
-      setPixelSegment(uint8_t n);
+      setPixelSegment(uint8_t n),
+      setTargetFps(uint8_t fps),
+      setPixelColorXY(uint16_t x, uint16_t y, uint32_t c),
+      fillRow(uint16_t y, uint32_t c),
+      fillColumn(uint16_t x, uint32_t c),
+      getRow(uint16_t y, uint32_t* buf),
+      setRow(uint16_t y, const uint32_t* buf),
+      getColumn(uint16_t x, uint32_t* buf),
+      setColumn(uint16_t x, const uint32_t* buf),
+      blur2D(uint8_t),
+      shift2D(int16_t dx, int16_t dy);
+
+    uint8_t addEffect(uint16_t (*fn)(void), const char* name, uint8_t palette = 0, uint8_t flags = 0);
+    const char* getModeName(uint8_t m);
 
     bool
       reverseMode = false,      //is the entire LED strip reversed?
+      effectFade = false,       //crossfade effect changes over the transition time
+      deterministicMode = false, //random numbers and time of effects only depend on the synced time, so nodes render the same frames
       gammaCorrectBri = false,
       gammaCorrectCol = true,
       applyToAllSelected = true,
@@ -637,7 +622,9 @@ class WS2812FX {
       getMaxSegments(void),
       //getFirstSelectedSegment(void),
       getMainSegmentId(void),
+      getCurrSegmentId(void),
       getColorOrder(void),
+      getTargetFps(void),
       gamma8(uint8_t),
       gamma8_cal(uint8_t, float),
       get_random_wheel_index(uint8_t);
@@ -648,8 +635,20 @@ class WS2812FX {
     uint16_t
       ablMilliampsMax,
       currentMilliamps,
+      getSegmentDataUsed(void),
+      getSegmentDataFreeBlock(void),
+      getSegmentDataCompactions(void),
+      getFrameTime(uint8_t segn),
       triwave16(uint16_t);
 
+    // render timing in us, moving averages over ~16 frames
+    uint16_t perfEffectUs[MAX_NUM_SEGMENTS] = {0};
+    uint32_t perfSegmentFrames[MAX_NUM_SEGMENTS] = {0}; // frames rendered per segment since boot
+    uint32_t
+      perfAblUs = 0,
+      perfShowUs = 0,
+      perfFrames = 0; // frames shown since boot
+
     uint32_t
       now,
       timebase,
@@ -659,7 +658,9 @@ class WS2812FX {
       currentColor(uint32_t colorNew, uint8_t tNr),
       gamma32(uint32_t),
       getLastShow(void),
+      timeToNextFrame(void),
       getPixelColor(uint16_t),
+      getPixelColorXY(uint16_t x, uint16_t y),
       getColor(void);
 
     WS2812FX::Segment&
@@ -791,24 +792,52 @@ class WS2812FX {
       mode_candy_cane(void),
       mode_blends(void),
       mode_tv_simulator(void),
-      mode_dynamic_smooth(void);
+      mode_dynamic_smooth(void),
+      mode_2D_noise(void),
+      mode_2D_matrix_rain(void),
+      mode_2D_lissajous(void);
 
   private:
     NeoPixelWrapper *bus;
 
     uint32_t crgb_to_col(CRGB fastled);
     CRGB col_to_crgb(uint32_t);
-    CRGBPalette16 currentPalette;
-    CRGBPalette16 targetPalette;
 
     uint16_t _length, _lengthRaw, _virtualSegmentLength;
     uint16_t _rand16seed;
     uint8_t _brightness;
     uint16_t _usedSegmentData = 0;
+    uint16_t _segmentDataTop = 0;      // end of the highest block in the arena
+    uint16_t _segmentDataCompactions = 0;
+    alignas(4) byte _segmentData[MAX_SEGMENT_DATA]; // arena for the data of all segments
     uint16_t _transitionDur = 750;
+    uint8_t _targetFps = WLED_FPS;
+    uint16_t _frametime = 1000/WLED_FPS;    // of the segment that is rendered, see FRAMETIME
+    uint16_t _minShowDelay = MIN_SHOW_DELAY;
 
-    void load_gradient_palette(uint8_t);
+    void load_gradient_palette(uint8_t, CRGBPalette16&);
     void handle_palette(void);
+    CRGB* getPaletteLUT(void);
+    void handle_matrix(void);
+
+    uint16_t* _xyMap = nullptr;   //XY map of the segment that is rendered, nullptr for 1D segments
+    uint16_t _segmentWidth = 0, _segmentHeight = 0;
+
+    //segment pixel at x,y of the segment that is rendered
+    inline uint16_t XY(uint16_t x, uint16_t y) {
+      return _xyMap ? _xyMap[y * SEGW + x] : y * SEGW + x;
+    }
+
+    byte* allocateSegmentData(uint16_t len);
+    void freeSegmentData(byte* block, uint16_t len);
+    void compactSegmentData(void);
+    Segment_runtime* nextSegmentDataBlock(byte* from);
+
+    mode_transition* getModeTransition(uint8_t segn);
+    bool startModeTransition(uint8_t segn, uint8_t m);
+    void endModeTransition(mode_transition* t);
+    uint16_t renderModeTransition(mode_transition* t);
+    void swapModeTransitionFrame(mode_transition* t);
 
     bool
       shouldStartBus = false,
@@ -816,7 +845,23 @@ class WS2812FX {
       _skipFirstMode,
       _triggered;
 
-    mode_ptr _mode[MODE_COUNT]; // SRAM footprint: 4 bytes per element
+    static const effect_entry _effects[MODE_COUNT]; // in flash
+    effect_entry _usermodEffects[MAX_USERMOD_EFFECTS];
+    uint8_t _usermodEffectCount = 0;
+
+    const effect_entry* getEffectEntry(uint8_t m);
+    uint16_t runEffect(uint8_t m);
+    uint16_t renderScaled(uint8_t scale);
+
+    uint8_t _renderScale = 0;     //render scale of the effect that is rendered, 0 for all pixels
+    uint16_t _renderLength = 0;   //segment length while rendering scaled
+
+    //pixel at which sample i of a scaled effect is shown, i if all pixels are rendered
+    inline uint16_t samplePos(uint16_t i) {
+      if (!_renderScale) return i;
+      uint32_t p = (uint32_t)i * _renderScale;
+      return (p < _renderLength) ? p : _renderLength -1;
+    }
 
     show_callback _callback = nullptr;
 
@@ -849,7 +894,6 @@ class WS2812FX {
       blendPixelColor(uint16_t n, uint32_t color, uint8_t blend),
       startTransition(uint8_t oldBri, uint32_t oldCol, uint16_t dur, uint8_t segn, uint8_t slot);
     
-    uint32_t _lastPaletteChange = 0;
     uint32_t _lastShow = 0;
 
     uint32_t _colors_t[3];
@@ -862,37 +906,153 @@ class WS2812FX {
     #endif
     
     uint8_t _segment_index = 0;
-    uint8_t _segment_index_palette_last = 99;
-    segment _segments[MAX_NUM_SEGMENTS] = { // SRAM footprint: 24 bytes per element
-      // start, stop, speed, intensity, palette, mode, options, grouping, spacing, opacity (unused), color[]
-      { 0, 7, DEFAULT_SPEED, 128, 0, DEFAULT_MODE, NO_OPTIONS, 1, 0, 255, {DEFAULT_COLOR}}
+    segment _segments[MAX_NUM_SEGMENTS] = { // SRAM footprint: 32 bytes per element
+      // start, stop, speed, intensity, palette, mode, options, grouping, spacing, opacity (unused), fps, scale, width, matrix, color[]
+      { 0, 7, DEFAULT_SPEED, 128, 0, DEFAULT_MODE, NO_OPTIONS, 1, 0, 255, 0, 0, 0, 0, {DEFAULT_COLOR}}
     };
     segment_runtime _segment_runtimes[MAX_NUM_SEGMENTS]; // SRAM footprint: 28 bytes per element
     friend class Segment_runtime;
+    segment_palette _segment_palettes[MAX_NUM_SEGMENTS]; // SRAM footprint: 120 bytes per element
+    segment_matrix _segment_matrices[MAX_NUM_SEGMENTS]; // SRAM footprint: 16 bytes per element
 
     ColorTransition transitions[MAX_NUM_TRANSITIONS]; //12 bytes per element
     friend class ColorTransition;
 
+    mode_transition _modeTransitions[MAX_NUM_MODE_TRANSITIONS]; //64 bytes per element
+    uint8_t _modeTransitionCount = 0;
+    bool _renderingModeTransition = false; //crossfade data must not be freed for other allocations
+
     uint16_t
       realPixelIndex(uint16_t i),
       transitionProgress(uint8_t tNr);
 };
 
-//10 names per line
-const char JSON_mode_names[] PROGMEM = R"=====([
-"Solid","Blink","Breathe","Wipe","Wipe Random","Random Colors","Sweep","Dynamic","Colorloop","Rainbow",
-"Scan","Scan Dual","Fade","Theater","Theater Rainbow","Running","Saw","Twinkle","Dissolve","Dissolve Rnd",
-"Sparkle","Sparkle Dark","Sparkle+","Strobe","Strobe Rainbow","Strobe Mega","Blink Rainbow","Android","Chase","Chase Random",
-"Chase Rainbow","Chase Flash","Chase Flash Rnd","Rainbow Runner","Colorful","Traffic Light","Sweep Random","Running 2","Aurora","Stream",
-"Scanner","Lighthouse","Fireworks","Rain","Merry Christmas","Fire Flicker","Gradient","Loading","Police","Police All",
-"Two Dots","Two Areas","Circus","Halloween","Tri Chase","Tri Wipe","Tri Fade","Lightning","ICU","Multi Comet",
-"Scanner Dual","Stream 2","Oscillate","Pride 2015","Juggle","Palette","Fire 2012","Colorwaves","Bpm","Fill Noise",
-"Noise 1","Noise 2","Noise 3","Noise 4","Colortwinkles","Lake","Meteor","Meteor Smooth","Railway","Ripple",
-"Twinklefox","Twinklecat","Halloween Eyes","Solid Pattern","Solid Pattern Tri","Spots","Spots Fade","Glitter","Candle","Fireworks Starburst",
-"Fireworks 1D","Bouncing Balls","Sinelon","Sinelon Dual","Sinelon Rainbow","Popcorn","Drip","Plasma","Percent","Ripple Rainbow",
-"Heartbeat","Pacifica","Candle Multi", "Solid Glitter","Sunrise","Phased","Twinkleup","Noise Pal", "Sine","Phased Noise",
-"Flow","Chunchun","Dancing Shadows","Washing Machine","Candy Cane","Blends","TV Simulator","Dynamic Smooth"
-])=====";
+/*
+ * Effect list: id, effect function, name, palette used for "Default", segment data in bytes per LED, flags.
+ * It has to be in the order of the ids, the effect table and /json/eff are generated from it.
+ */
+#define WLED_EFFECTS(X) \
+  X(FX_MODE_STATIC,                mode_static,                "Solid",                 0, 0, 0) \
+  X(FX_MODE_BLINK,                 mode_blink,                 "Blink",                 0, 0, 0) \
+  X(FX_MODE_BREATH,                mode_breath,                "Breathe",               0, 0, 0) \
+  X(FX_MODE_COLOR_WIPE,            mode_color_wipe,            "Wipe",                  0, 0, 0) \
+  X(FX_MODE_COLOR_WIPE_RANDOM,     mode_color_wipe_random,     "Wipe Random",           0, 0, 0) \
+  X(FX_MODE_RANDOM_COLOR,          mode_random_color,          "Random Colors",         0, 0, 0) \
+  X(FX_MODE_COLOR_SWEEP,           mode_color_sweep,           "Sweep",                 0, 0, 0) \
+  X(FX_MODE_DYNAMIC,               mode_dynamic,               "Dynamic",               0, 1, 0) \
+  X(FX_MODE_RAINBOW,               mode_rainbow,               "Colorloop",             0, 0, 0) \
+  X(FX_MODE_RAINBOW_CYCLE,         mode_rainbow_cycle,         "Rainbow",               0, 0, 0) \
+  X(FX_MODE_SCAN,                  mode_scan,                  "Scan",                  0, 0, 0) \
+  X(FX_MODE_DUAL_SCAN,             mode_dual_scan,             "Scan Dual",             0, 0, 0) \
+  X(FX_MODE_FADE,                  mode_fade,                  "Fade",                  0, 0, 0) \
+  X(FX_MODE_THEATER_CHASE,         mode_theater_chase,         "Theater",               0, 0, 0) \
+  X(FX_MODE_THEATER_CHASE_RAINBOW, mode_theater_chase_rainbow, "Theater Rainbow",       0, 0, 0) \
+  X(FX_MODE_RUNNING_LIGHTS,        mode_running_lights,        "Running",               0, 0, 0) \
+  X(FX_MODE_SAW,                   mode_saw,                   "Saw",                   0, 0, 0) \
+  X(FX_MODE_TWINKLE,               mode_twinkle,               "Twinkle",               0, 0, 0) \
+  X(FX_MODE_DISSOLVE,              mode_dissolve,              "Dissolve",              0, 0, 0) \
+  X(FX_MODE_DISSOLVE_RANDOM,       mode_dissolve_random,       "Dissolve Rnd",          0, 0, 0) \
+  X(FX_MODE_SPARKLE,               mode_sparkle,               "Sparkle",               0, 0, 0) \
+  X(FX_MODE_FLASH_SPARKLE,         mode_flash_sparkle,         "Sparkle Dark",          0, 0, 0) \
+  X(FX_MODE_HYPER_SPARKLE,         mode_hyper_sparkle,         "Sparkle+",              0, 0, 0) \
+  X(FX_MODE_STROBE,                mode_strobe,                "Strobe",                0, 0, 0) \
+  X(FX_MODE_STROBE_RAINBOW,        mode_strobe_rainbow,        "Strobe Rainbow",        0, 0, 0) \
+  X(FX_MODE_MULTI_STROBE,          mode_multi_strobe,          "Strobe Mega",           0, 0, 0) \
+  X(FX_MODE_BLINK_RAINBOW,         mode_blink_rainbow,         "Blink Rainbow",         0, 0, 0) \
+  X(FX_MODE_ANDROID,               mode_android,               "Android",               0, 0, 0) \
+  X(FX_MODE_CHASE_COLOR,           mode_chase_color,           "Chase",                 0, 0, 0) \
+  X(FX_MODE_CHASE_RANDOM,          mode_chase_random,          "Chase Random",          0, 0, 0) \
+  X(FX_MODE_CHASE_RAINBOW,         mode_chase_rainbow,         "Chase Rainbow",         0, 0, 0) \
+  X(FX_MODE_CHASE_FLASH,           mode_chase_flash,           "Chase Flash",           0, 0, 0) \
+  X(FX_MODE_CHASE_FLASH_RANDOM,    mode_chase_flash_random,    "Chase Flash Rnd",       0, 0, 0) \
+  X(FX_MODE_CHASE_RAINBOW_WHITE,   mode_chase_rainbow_white,   "Rainbow Runner",        0, 0, 0) \
+  X(FX_MODE_COLORFUL,              mode_colorful,              "Colorful",              0, 0, 0) \
+  X(FX_MODE_TRAFFIC_LIGHT,         mode_traffic_light,         "Traffic Light",         0, 0, 0) \
+  X(FX_MODE_COLOR_SWEEP_RANDOM,    mode_color_sweep_random,    "Sweep Random",          0, 0, 0) \
+  X(FX_MODE_RUNNING_COLOR,         mode_running_color,         "Running 2",             0, 0, 0) \
+  X(FX_MODE_AURORA,                mode_aurora,                "Aurora",                0, 0, 0) \
+  X(FX_MODE_RUNNING_RANDOM,        mode_running_random,        "Stream",                0, 0, 0) \
+  X(FX_MODE_LARSON_SCANNER,        mode_larson_scanner,        "Scanner",               0, 0, 0) \
+  X(FX_MODE_COMET,                 mode_comet,                 "Lighthouse",            0, 0, 0) \
+  X(FX_MODE_FIREWORKS,             mode_fireworks,             "Fireworks",             0, 0, 0) \
+  X(FX_MODE_RAIN,                  mode_rain,                  "Rain",                  0, 0, 0) \
+  X(FX_MODE_MERRY_CHRISTMAS,       mode_merry_christmas,       "Merry Christmas",       0, 0, 0) \
+  X(FX_MODE_FIRE_FLICKER,          mode_fire_flicker,          "Fire Flicker",          0, 0, 0) \
+  X(FX_MODE_GRADIENT,              mode_gradient,              "Gradient",              0, 0, 0) \
+  X(FX_MODE_LOADING,               mode_loading,               "Loading",               0, 0, 0) \
+  X(FX_MODE_POLICE,                mode_police,                "Police",                0, 0, 0) \
+  X(FX_MODE_POLICE_ALL,            mode_police_all,            "Police All",            0, 0, 0) \
+  X(FX_MODE_TWO_DOTS,              mode_two_dots,              "Two Dots",              0, 0, 0) \
+  X(FX_MODE_TWO_AREAS,             mode_two_areas,             "Two Areas",             0, 0, 0) \
+  X(FX_MODE_CIRCUS_COMBUSTUS,      mode_circus_combustus,      "Circus",                0, 0, 0) \
+  X(FX_MODE_HALLOWEEN,             mode_halloween,             "Halloween",             0, 0, 0) \
+  X(FX_MODE_TRICOLOR_CHASE,        mode_tricolor_chase,        "Tri Chase",             0, 0, 0) \
+  X(FX_MODE_TRICOLOR_WIPE,         mode_tricolor_wipe,         "Tri Wipe",              0, 0, 0) \
+  X(FX_MODE_TRICOLOR_FADE,         mode_tricolor_fade,         "Tri Fade",              0, 0, 0) \
+  X(FX_MODE_LIGHTNING,             mode_lightning,             "Lightning",             0, 0, 0) \
+  X(FX_MODE_ICU,                   mode_icu,                   "ICU",                   0, 0, 0) \
+  X(FX_MODE_MULTI_COMET,           mode_multi_comet,           "Multi Comet",           0, 0, 0) \
+  X(FX_MODE_DUAL_LARSON_SCANNER,   mode_dual_larson_scanner,   "Scanner Dual",          0, 0, 0) \
+  X(FX_MODE_RANDOM_CHASE,          mode_random_chase,          "Stream 2",              0, 0, 0) \
+  X(FX_MODE_OSCILLATE,             mode_oscillate,             "Oscillate",             0, 0, 0) \
+  X(FX_MODE_PRIDE_2015,            mode_pride_2015,            "Pride 2015",            0, 0, 0) \
+  X(FX_MODE_JUGGLE,                mode_juggle,                "Juggle",                0, 0, 0) \
+  X(FX_MODE_PALETTE,               mode_palette,               "Palette",               0, 0, 0) \
+  X(FX_MODE_FIRE_2012,             mode_fire_2012,             "Fire 2012",            35, 1, 0) \
+  X(FX_MODE_COLORWAVES,            mode_colorwaves,            "Colorwaves",           26, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_BPM,                   mode_bpm,                   "Bpm",                   0, 0, 0) \
+  X(FX_MODE_FILLNOISE8,            mode_fillnoise8,            "Fill Noise",            9, 0, 0) \
+  X(FX_MODE_NOISE16_1,             mode_noise16_1,             "Noise 1",              20, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_NOISE16_2,             mode_noise16_2,             "Noise 2",              43, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_NOISE16_3,             mode_noise16_3,             "Noise 3",              35, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_NOISE16_4,             mode_noise16_4,             "Noise 4",              26, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_COLORTWINKLE,          mode_colortwinkle,          "Colortwinkles",         0, 1, 0) \
+  X(FX_MODE_LAKE,                  mode_lake,                  "Lake",                  0, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_METEOR,                mode_meteor,                "Meteor",                4, 1, 0) \
+  X(FX_MODE_METEOR_SMOOTH,         mode_meteor_smooth,         "Meteor Smooth",         4, 1, 0) \
+  X(FX_MODE_RAILWAY,               mode_railway,               "Railway",               4, 0, 0) \
+  X(FX_MODE_RIPPLE,                mode_ripple,                "Ripple",                4, 0, 0) \
+  X(FX_MODE_TWINKLEFOX,            mode_twinklefox,            "Twinklefox",            4, 0, 0) \
+  X(FX_MODE_TWINKLECAT,            mode_twinklecat,            "Twinklecat",            4, 0, 0) \
+  X(FX_MODE_HALLOWEEN_EYES,        mode_halloween_eyes,        "Halloween Eyes",        4, 0, FX_FLAG_OWN_CALLS) \
+  X(FX_MODE_STATIC_PATTERN,        mode_static_pattern,        "Solid Pattern",         4, 0, 0) \
+  X(FX_MODE_TRI_STATIC_PATTERN,    mode_tri_static_pattern,    "Solid Pattern Tri",     4, 0, 0) \
+  X(FX_MODE_SPOTS,                 mode_spots,                 "Spots",                 4, 0, 0) \
+  X(FX_MODE_SPOTS_FADE,            mode_spots_fade,            "Spots Fade",            4, 0, 0) \
+  X(FX_MODE_GLITTER,               mode_glitter,               "Glitter",              11, 0, 0) \
+  X(FX_MODE_CANDLE,                mode_candle,                "Candle",                4, 0, 0) \
+  X(FX_MODE_STARBURST,             mode_starburst,             "Fireworks Starburst",   4, 0, 0) \
+  X(FX_MODE_EXPLODING_FIREWORKS,   mode_exploding_fireworks,   "Fireworks 1D",          4, 0, 0) \
+  X(FX_MODE_BOUNCINGBALLS,         mode_bouncing_balls,        "Bouncing Balls",        4, 0, 0) \
+  X(FX_MODE_SINELON,               mode_sinelon,               "Sinelon",               4, 0, 0) \
+  X(FX_MODE_SINELON_DUAL,          mode_sinelon_dual,          "Sinelon Dual",          4, 0, 0) \
+  X(FX_MODE_SINELON_RAINBOW,       mode_sinelon_rainbow,       "Sinelon Rainbow",       4, 0, 0) \
+  X(FX_MODE_POPCORN,               mode_popcorn,               "Popcorn",               4, 0, 0) \
+  X(FX_MODE_DRIP,                  mode_drip,                  "Drip",                  4, 0, 0) \
+  X(FX_MODE_PLASMA,                mode_plasma,                "Plasma",                4, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_PERCENT,               mode_percent,               "Percent",               4, 0, 0) \
+  X(FX_MODE_RIPPLE_RAINBOW,        mode_ripple_rainbow,        "Ripple Rainbow",        4, 0, 0) \
+  X(FX_MODE_HEARTBEAT,             mode_heartbeat,             "Heartbeat",             4, 0, 0) \
+  X(FX_MODE_PACIFICA,              mode_pacifica,              "Pacifica",              4, 0, FX_FLAG_SCALABLE) \
+  X(FX_MODE_CANDLE_MULTI,          mode_candle_multi,          "Candle Multi",          4, 3, 0) \
+  X(FX_MODE_SOLID_GLITTER,         mode_solid_glitter,         "Solid Glitter",         4, 0, 0) \
+  X(FX_MODE_SUNRISE,               mode_sunrise,               "Sunrise",              35, 0, 0) \
+  X(FX_MODE_PHASED,                mode_phased,                "Phased",                4, 0, 0) \
+  X(FX_MODE_TWINKLEUP,             mode_twinkleup,             "Twinkleup",             4, 0, 0) \
+  X(FX_MODE_NOISEPAL,              mode_noisepal,              "Noise Pal",             4, 0, 0) \
+  X(FX_MODE_SINEWAVE,              mode_sinewave,              "Sine",                  4, 0, 0) \
+  X(FX_MODE_PHASEDNOISE,           mode_phased_noise,          "Phased Noise",          4, 0, 0) \
+  X(FX_MODE_FLOW,                  mode_flow,                  "Flow",                  6, 0, 0) \
+  X(FX_MODE_CHUNCHUN,              mode_chunchun,              "Chunchun",              4, 0, 0) \
+  X(FX_MODE_DANCING_SHADOWS,       mode_dancing_shadows,       "Dancing Shadows",       4, 0, 0) \
+  X(FX_MODE_WASHING_MACHINE,       mode_washing_machine,       "Washing Machine",       4, 0, 0) \
+  X(FX_MODE_CANDY_CANE,            mode_candy_cane,            "Candy Cane",            4, 0, 0) \
+  X(FX_MODE_BLENDS,                mode_blends,                "Blends",                4, 4, 0) \
+  X(FX_MODE_TV_SIMULATOR,          mode_tv_simulator,          "TV Simulator",          4, 0, 0) \
+  X(FX_MODE_DYNAMIC_SMOOTH,        mode_dynamic_smooth,        "Dynamic Smooth",        4, 1, 0) \
+  X(FX_MODE_2D_NOISE,              mode_2D_noise,              "Noise 2D",             26, 0, 0) \
+  X(FX_MODE_2D_MATRIX_RAIN,        mode_2D_matrix_rain,        "Matrix Rain 2D",        4, 0, 0) \
+  X(FX_MODE_2D_LISSAJOUS,          mode_2D_lissajous,          "Lissajous 2D",          4, 0, 0)
 
 
 const char JSON_palette_names[] PROGMEM = R"=====([
@@ -24,6 +24,7 @@
   Modified heavily for WLED
 */
 
+#include <utility>
 #include "FX.h"
 #include "palettes.h"
 
@@ -52,6 +53,9 @@ void WS2812FX::init(bool supportWhite, uint16_t countPixels, bool skipFirst)
 {
   if (supportWhite == _useRgbw && countPixels == _length && _skipFirstMode == skipFirst) return;
   RESET_RUNTIME;
+  for (uint8_t i = 0; i < MAX_NUM_MODE_TRANSITIONS; i++) _modeTransitions[i] = mode_transition();
+  _modeTransitionCount = 0;
+  _usedSegmentData = 0; _segmentDataTop = 0; //all data pointers were cleared
   _useRgbw = supportWhite;
   _length = countPixels;
   _skipFirstMode = skipFirst;
@@ -71,11 +75,30 @@ void WS2812FX::init(bool supportWhite, uint16_t countPixels, bool skipFirst)
   setBrightness(_brightness);
 }
 
+//moving average over ~16 samples, as used for the render timing
+uint32_t perfAverage(uint32_t avg, uint32_t sample) {
+  return avg ? (avg * 15 + sample) >> 4 : sample;
+}
+
+//seed for the random numbers of segment segn in a frame slot, the same on all nodes with the same timebase
+uint16_t frameSeed(uint32_t slot, uint8_t segn) {
+  uint32_t h = (slot + segn * 0x9E3779B9) * 2654435761UL;
+  return (h >> 16) ^ h;
+}
+
 void WS2812FX::service() {
   uint32_t nowUp = millis(); // Be aware, millis() rolls over every 49 days
   now = nowUp + timebase;
-  if (nowUp - _lastShow < MIN_SHOW_DELAY) return;
-  bool doShow = false;
+  if (nowUp - _lastShow < _minShowDelay) return;
+  uint32_t nowSynced = now;
+
+  //segments that are due before another show could happen are rendered with this one,
+  //so segments with different frame rates share shows and fall into step
+  bool doShow = _triggered;
+  for (uint8_t i = 0; i < MAX_NUM_SEGMENTS && !doShow; i++) {
+    if (_segments[i].isActive() && (nowUp > _segment_runtimes[i].next_time || _segment_runtimes[i]._requiresReset)) doShow = true;
+  }
+  uint32_t renderUntil = (doShow && !deterministicMode) ? nowUp + _minShowDelay : nowUp;
 
   for(uint8_t i=0; i < MAX_NUM_SEGMENTS; i++)
   {
@@ -85,13 +108,27 @@ void WS2812FX::service() {
     // segment's buffers are cleared
     SEGENV.resetIfRequired();
 
-    if (!SEGMENT.isActive()) continue;
+    if (!SEGMENT.isActive()) {
+      if (_segment_palettes[i].lut) _segment_palettes[i].freeLUT();
+      if (_segment_matrices[i].map) _segment_matrices[i].freeMap();
+      if (_modeTransitionCount) {
+        mode_transition* mt = getModeTransition(i);
+        if (mt) endModeTransition(mt);
+      }
+      continue;
+    }
 
-    if(nowUp > SEGENV.next_time || _triggered || (doShow && SEGMENT.mode == 0)) //last is temporary
+    if(renderUntil > SEGENV.next_time || _triggered || (doShow && SEGMENT.mode == 0)) //last is temporary
     {
       if (SEGMENT.grouping == 0) SEGMENT.grouping = 1; //sanity check
       doShow = true;
+      _frametime = getFrameTime(i);
       uint16_t delay = FRAMETIME;
+      if (deterministicMode) { //frames are rendered at the start of a slot of the synced time, effects see the slot time
+        uint32_t slot = nowSynced / _frametime;
+        now = slot * _frametime;
+        random16_set_seed(frameSeed(slot, i));
+      }
 
       if (!SEGMENT.getOption(SEG_OPTION_FREEZE)) { //only run effect function if not frozen
         _virtualSegmentLength = SEGMENT.virtualLength();
@@ -105,14 +142,29 @@ void WS2812FX::service() {
         }
         for (uint8_t c = 0; c < 3; c++) _colors_t[c] = gamma32(_colors_t[c]);
         handle_palette();
-        delay = (this->*_mode[SEGMENT.mode])(); //effect function
-        if (SEGMENT.mode != FX_MODE_HALLOWEEN_EYES) SEGENV.call++;
+        handle_matrix();
+        uint32_t fxStart = micros();
+        uint8_t fxFlags = pgm_read_byte(&getEffectEntry(SEGMENT.mode)->flags);
+        mode_transition* mt = _modeTransitionCount ? getModeTransition(i) : nullptr;
+        if (mt) delay = renderModeTransition(mt); //both effects and the blend
+        else if (SEGMENT.scale > 1 && (fxFlags & FX_FLAG_SCALABLE)) delay = renderScaled(SEGMENT.scale);
+        else    delay = runEffect(SEGMENT.mode); //effect function
+        uint32_t fxUs = micros() - fxStart;
+        perfEffectUs[i] = perfAverage(perfEffectUs[i], fxUs > UINT16_MAX ? UINT16_MAX : fxUs);
+        if (!(fxFlags & FX_FLAG_OWN_CALLS)) SEGENV.call++;
+        perfSegmentFrames[i]++;
       }
 
-      SEGENV.next_time = nowUp + delay;
+      if (SEGMENT.fps && delay < FRAMETIME) delay = FRAMETIME; //an own frame rate is a cap for the effect
+      uint32_t due = nowUp + delay;
+      if (deterministicMode) due += (_frametime - (due + timebase) % _frametime) % _frametime; //next slot start
+      SEGENV.next_time = due;
     }
   }
   _virtualSegmentLength = 0;
+  _xyMap = nullptr;
+  _frametime = getFrameTime(255);
+  now = nowSynced;
   if(doShow) {
     yield();
     show();
@@ -132,6 +184,7 @@ void WS2812FX::setPixelColor(uint16_t n, uint32_t c) {
 
 //used to map from segment index to physical pixel, taking into account grouping, offsets, reverse and mirroring
 uint16_t WS2812FX::realPixelIndex(uint16_t i) {
+  if (_renderScale) i = samplePos(i);
   int16_t iGroup = i * SEGMENT.groupLength();
 
   /* reverse just an individual segment */
@@ -234,6 +287,7 @@ void WS2812FX::show(void) {
   // avoid race condition, caputre _callback value
   show_callback callback = _callback;
   if (callback) callback();
+  uint32_t ablStart = micros();
 
   //power limit calculation
   //each LED can draw up 195075 "power units" (approx. 53mA)
@@ -306,10 +360,15 @@ void WS2812FX::show(void) {
     bus->SetBrightness(_brightness);
   }
   
+  uint32_t showStart = micros();
+  perfAblUs = perfAverage(perfAblUs, showStart - ablStart);
+
   // some buses send asynchronously and this method will return before
   // all of the data has been sent.
   // See https://github.com/Makuna/NeoPixelBus/wiki/ESP32-NeoMethods#neoesp32rmt-methods
   bus->Show();
+  perfShowUs = perfAverage(perfShowUs, micros() - showStart);
+  perfFrames++;
   _lastShow = millis();
 }
 
@@ -321,6 +380,24 @@ bool WS2812FX::isUpdating() {
   return !bus->CanShow();
 }
 
+/**
+ * Returns the number of ms until service() will render the next frame, 0 if a frame is due.
+ */
+uint32_t WS2812FX::timeToNextFrame() {
+  if (_triggered) return 0;
+  uint32_t nowUp = millis();
+  uint32_t wait = UINT32_MAX;
+  for (uint8_t i = 0; i < MAX_NUM_SEGMENTS; i++) {
+    if (!_segments[i].isActive()) continue;
+    uint32_t next = _segment_runtimes[i].next_time;
+    uint32_t segWait = (nowUp > next) ? 0 : next - nowUp +1;
+    if (segWait < wait) wait = segWait;
+  }
+  uint32_t sinceShow = nowUp - _lastShow;
+  if (sinceShow < _minShowDelay && wait < _minShowDelay - sinceShow) wait = _minShowDelay - sinceShow;
+  return wait;
+}
+
 /**
  * Forces the next frame to be computed on all active segments.
  */
@@ -331,18 +408,379 @@ void WS2812FX::trigger() {
 void WS2812FX::setMode(uint8_t segid, uint8_t m) {
   if (segid >= MAX_NUM_SEGMENTS) return;
    
-  if (m >= MODE_COUNT) m = MODE_COUNT - 1;
+  if (m >= getModeCount()) m = getModeCount() - 1;
 
   if (_segments[segid].mode != m) 
   {
-    _segment_runtimes[segid].reset();
+    if (!effectFade || !_transitionDur || !_brightness || !startModeTransition(segid, m)) _segment_runtimes[segid].reset();
     _segments[segid].mode = m;
   }
 }
 
+/*
+ * Effect crossfade. With effectFade set, an effect change keeps the outgoing effect running for the transition time.
+ * Its runtime data and last frame are kept in the segment data arena only while the crossfade runs.
+ * Every frame the outgoing effect renders on its own previous frame and the new effect on the frame shown last,
+ * then both are blended. Effects have precedence, a crossfade ends early if an effect needs its memory.
+ */
+WS2812FX::mode_transition* WS2812FX::getModeTransition(uint8_t segn) {
+  for (uint8_t i = 0; i < MAX_NUM_MODE_TRANSITIONS; i++) {
+    if (_modeTransitions[i].segment == segn) return &_modeTransitions[i];
+  }
+  return nullptr;
+}
+
+//hands the runtime of the current effect of segment segn over to a crossfade to effect m.
+//Returns false if there is none free or the segment data of m and the frame would not fit
+bool WS2812FX::startModeTransition(uint8_t segn, uint8_t m) {
+  Segment_runtime& rt = _segment_runtimes[segn];
+  if (rt._requiresReset || rt.call == 0 || !_segments[segn].isActive()) return false; //nothing to fade from
+  uint32_t len = _segments[segn].virtualLength();
+  uint32_t need = (pgm_read_byte(&getEffectEntry(m)->data) + 4) * len;
+  if (need > MAX_SEGMENT_DATA - getSegmentDataUsed()) return false;
+
+  mode_transition* t = getModeTransition(segn);
+  if (t) { //already fading, the oldest effect is dropped
+    endModeTransition(t);
+  } else {
+    for (uint8_t i = 0; i < MAX_NUM_MODE_TRANSITIONS; i++) {
+      if (_modeTransitions[i].segment == 0xFF) { t = &_modeTransitions[i]; break; }
+    }
+    if (!t) return false;
+  }
+
+  t->runtime = rt;
+  rt.data = nullptr; rt._dataLen = 0; //the data is owned by the crossfade now
+  rt.reset();
+  t->mode = _segments[segn].mode;
+  t->segment = segn;
+  t->transitionStart = millis();
+  t->transitionDur = _transitionDur;
+  _modeTransitionCount++;
+  return true;
+}
+
+void WS2812FX::endModeTransition(mode_transition* t) {
+  t->runtime.deallocateData();
+  t->frame.deallocateData();
+  t->segment = 0xFF;
+  _modeTransitionCount--;
+}
+
+//exchanges the segment pixels with the frame kept by the crossfade
+void WS2812FX::swapModeTransitionFrame(mode_transition* t) {
+  uint32_t* frame = reinterpret_cast<uint32_t*>(t->frame.data);
+  for (uint16_t i = 0; i < SEGLEN; i++) {
+    uint32_t c = getPixelColor(i);
+    setPixelColor(i, frame[i]);
+    frame[i] = c;
+  }
+}
+
+uint16_t WS2812FX::renderModeTransition(mode_transition* t) {
+  uint32_t elapsed = millis() - t->transitionStart;
+  bool first = (t->frame.data == nullptr);
+
+  _renderingModeTransition = true;
+  bool ok = elapsed < t->transitionDur && SEGLEN <= MAX_SEGMENT_DATA / 4 && t->frame.allocateData(SEGLEN * 4);
+  _renderingModeTransition = false;
+  if (!ok) {
+    endModeTransition(t);
+    return runEffect(SEGMENT.mode);
+  }
+
+  uint8_t bri = _bri_t;
+  _bri_t = 255; //both effects render unscaled, opacity is applied once to the blended frame
+  if (first) { //the outgoing effect has rendered the pixels of the segment last
+    uint32_t* frame = reinterpret_cast<uint32_t*>(t->frame.data);
+    for (uint16_t i = 0; i < SEGLEN; i++) frame[i] = getPixelColor(i);
+  }
+
+  //outgoing effect
+  //the runtimes are swapped, not copied, so every data block stays referenced by exactly one runtime
+  //that nextSegmentDataBlock() scans and compaction during the outgoing effect moves it correctly
+  swapModeTransitionFrame(t);
+  std::swap(SEGENV, t->runtime);
+  _renderingModeTransition = true;
+  runEffect(t->mode);
+  _renderingModeTransition = false;
+  if (!(pgm_read_byte(&getEffectEntry(t->mode)->flags) & FX_FLAG_OWN_CALLS)) SEGENV.call++;
+  std::swap(SEGENV, t->runtime);
+  swapModeTransitionFrame(t);
+
+  //new effect, which may end the crossfade if it needs the memory
+  uint16_t delay = runEffect(SEGMENT.mode);
+
+  _bri_t = bri;
+  if (t->segment == _segment_index) {
+    uint8_t progress = elapsed * 255 / t->transitionDur;
+    uint32_t* frame = reinterpret_cast<uint32_t*>(t->frame.data); //may have been moved by an allocation
+    for (uint16_t i = 0; i < SEGLEN; i++) {
+      setPixelColor(i, color_blend(frame[i], getPixelColor(i), progress));
+    }
+  }
+  return (delay < FRAMETIME) ? delay : FRAMETIME;
+}
+
+/*
+ * Render scale. The effect renders SEGLEN samples at every scale-th pixel and the last pixel (samplePos()),
+ * the pixels in between are interpolated linearly. Only for smooth effects (FX_FLAG_SCALABLE).
+ */
+uint16_t WS2812FX::renderScaled(uint8_t scale) {
+  uint16_t len = SEGLEN;
+  if (len <= scale) return runEffect(SEGMENT.mode);
+
+  _renderLength = len;
+  _renderScale = scale;
+  _virtualSegmentLength = (len + scale - 2) / scale + 1;
+  uint16_t delay = runEffect(SEGMENT.mode);
+  _renderScale = 0;
+  _virtualSegmentLength = len;
+
+  uint8_t bri = _bri_t;
+  _bri_t = 255; //the samples have the opacity applied already
+  uint32_t c0 = getPixelColor(0);
+  for (uint16_t p0 = 0; p0 < len -1; p0 += scale) {
+    uint16_t p1 = MIN(p0 + scale, len -1);
+    uint16_t span = p1 - p0;
+    uint32_t c1 = getPixelColor(p1);
+    for (uint16_t j = 1; j < span; j++) setPixelColor(p0 + j, color_blend(c0, c1, (j << 8) / span));
+    c0 = c1;
+  }
+  _bri_t = bri;
+  return delay;
+}
+
+void WS2812FX::setTargetFps(uint8_t fps) {
+  if (fps == 0) fps = WLED_FPS;
+  if (fps > WLED_FPS_MAX) fps = WLED_FPS_MAX;
+  _targetFps = fps;
+  _minShowDelay = (2000 / fps) / 3; //shows for triggers and transitions at up to 1.5 times the frame rate
+}
+
+uint8_t WS2812FX::getTargetFps() {
+  return _targetFps;
+}
+
+//saturating add of the red, green and blue channels of two colors
+static uint32_t addSeep(uint32_t a, uint32_t b)
+{
+  uint32_t rbSum = (a & 0x00FF00FF) + (b & 0x00FF00FF);
+  uint32_t gSum  = ((a >> 8) & 0xFF) + ((b >> 8) & 0xFF);
+  uint32_t ov = rbSum & 0x01000100;
+  rbSum = (rbSum | (ov - (ov >> 8))) & 0x00FF00FF;
+  if (gSum > 0xFF) gSum = 0xFF;
+  return rbSum | (gSum << 8);
+}
+
+//blur() of n colors in a buffer, for rows and columns of 2D segments
+static void blurLine(uint32_t* line, uint16_t n, uint8_t blur_amount)
+{
+  uint16_t keep = 256 - blur_amount;
+  uint16_t seep = (blur_amount >> 1) +1;
+  uint32_t carryover = 0;
+  for (uint16_t i = 0; i < n; i++)
+  {
+    uint32_t rb = line[i] & 0x00FF00FF;
+    uint32_t g  = (line[i] >> 8) & 0xFF;
+    uint32_t part = (((rb * seep) >> 8) & 0x00FF00FF) | (((g * seep) >> 8) << 8);
+    uint32_t cur  = (((rb * keep) >> 8) & 0x00FF00FF) | (((g * keep) >> 8) << 8);
+    if (i > 0) line[i-1] = addSeep(line[i-1], part);
+    line[i] = cur + carryover;
+    carryover = part;
+  }
+}
+
+/*
+ * 2D segments. A segment with a width is a matrix of width columns, wired row by row from the segment start.
+ * Its XY map gives the segment pixel of every logical x,y with serpentine wiring and rotation applied,
+ * it is built only when the segment or its layout changes. 1D segments are wrapped into rows of up to
+ * MAX_MATRIX_DIM pixels, so 2D effects run on them too. Rows and columns are processed in buffers.
+ */
+void WS2812FX::handle_matrix(void)
+{
+  segment_matrix* mx = &_segment_matrices[_segment_index];
+  uint16_t len = SEGLEN;
+  uint16_t w = MIN(SEGMENT.width, MAX_MATRIX_DIM);
+
+  if (w && w < len) {
+    uint16_t h = MIN(len / w, MAX_MATRIX_DIM);
+    if (!mx->map || mx->length != len || mx->width != w || mx->layout != SEGMENT.matrix) {
+      mx->freeMap();
+      mx->map = (uint16_t*)malloc(w * h * sizeof(uint16_t));
+    }
+    if (mx->map && !mx->length) {
+      uint8_t rot = MATRIX_ROTATION(SEGMENT.matrix);
+      bool serpentine = SEGMENT.matrix & MATRIX_SERPENTINE;
+      mx->cols = (rot & 1) ? h : w;
+      mx->rows = (rot & 1) ? w : h;
+      for (uint16_t y = 0; y < mx->rows; y++) {
+        for (uint16_t x = 0; x < mx->cols; x++) {
+          uint16_t px, py; //wired column and row
+          switch (rot) {
+            case 0:  px = x;        py = y;        break;
+            case 1:  px = y;        py = h -1 - x; break;
+            case 2:  px = w -1 - x; py = h -1 - y; break;
+            default: px = w -1 - y; py = x;        break;
+          }
+          if (serpentine && (py & 1)) px = w -1 - px;
+          mx->map[y * mx->cols + x] = py * w + px;
+        }
+      }
+      mx->length = len; mx->width = w; mx->layout = SEGMENT.matrix;
+    }
+    if (mx->map) {
+      _xyMap = mx->map;
+      _segmentWidth = mx->cols;
+      _segmentHeight = mx->rows;
+      return;
+    }
+  } else if (mx->map) {
+    mx->freeMap();
+  }
+
+  //1D segment, or no memory for the map
+  _xyMap = nullptr;
+  _segmentWidth = MIN(len, MAX_MATRIX_DIM);
+  _segmentHeight = _segmentWidth ? MIN((len + _segmentWidth -1) / _segmentWidth, MAX_MATRIX_DIM) : 0;
+}
+
+void WS2812FX::setPixelColorXY(uint16_t x, uint16_t y, uint32_t c)
+{
+  if (x >= SEGW || y >= SEGH) return;
+  uint16_t i = XY(x, y);
+  if (i < SEGLEN) setPixelColor(i, c);
+}
+
+uint32_t WS2812FX::getPixelColorXY(uint16_t x, uint16_t y)
+{
+  if (x >= SEGW || y >= SEGH) return 0;
+  uint16_t i = XY(x, y);
+  return (i < SEGLEN) ? getPixelColor(i) : 0;
+}
+
+void WS2812FX::fillRow(uint16_t y, uint32_t c)
+{
+  for (uint16_t x = 0; x < SEGW; x++) setPixelColorXY(x, y, c);
+}
+
+void WS2812FX::fillColumn(uint16_t x, uint32_t c)
+{
+  for (uint16_t y = 0; y < SEGH; y++) setPixelColorXY(x, y, c);
+}
+
+//copies row y to buf, SEGW colors
+void WS2812FX::getRow(uint16_t y, uint32_t* buf)
+{
+  for (uint16_t x = 0; x < SEGW; x++) buf[x] = getPixelColorXY(x, y);
+}
+
+void WS2812FX::setRow(uint16_t y, const uint32_t* buf)
+{
+  for (uint16_t x = 0; x < SEGW; x++) setPixelColorXY(x, y, buf[x]);
+}
+
+//copies column x to buf, SEGH colors
+void WS2812FX::getColumn(uint16_t x, uint32_t* buf)
+{
+  for (uint16_t y = 0; y < SEGH; y++) buf[y] = getPixelColorXY(x, y);
+}
+
+void WS2812FX::setColumn(uint16_t x, const uint32_t* buf)
+{
+  for (uint16_t y = 0; y < SEGH; y++) setPixelColorXY(x, y, buf[y]);
+}
+
+//blur() along the rows, then along the columns
+void WS2812FX::blur2D(uint8_t blur_amount)
+{
+  uint32_t line[MAX_MATRIX_DIM];
+  for (uint16_t y = 0; y < SEGH; y++) {
+    getRow(y, line);
+    blurLine(line, SEGW, blur_amount);
+    setRow(y, line);
+  }
+  for (uint16_t x = 0; x < SEGW; x++) {
+    getColumn(x, line);
+    blurLine(line, SEGH, blur_amount);
+    setColumn(x, line);
+  }
+}
+
+//moves the picture dx columns to the right and dy rows down (left and up if negative), uncovered pixels are black
+void WS2812FX::shift2D(int16_t dx, int16_t dy)
+{
+  if (!dx && !dy) return;
+  uint32_t line[MAX_MATRIX_DIM];
+  uint16_t w = SEGW, h = SEGH;
+  uint16_t s = abs(dx);
+  for (uint16_t n = 0; n < h; n++) {
+    uint16_t y = (dy > 0) ? h -1 - n : n; //a row is only overwritten after it was moved
+    int32_t src = (int32_t)y - dy;
+    if (src < 0 || src >= h || s >= w) {
+      memset(line, 0, w * sizeof(uint32_t));
+    } else {
+      getRow(src, line);
+      if (dx > 0) {
+        memmove(line + s, line, (w - s) * sizeof(uint32_t));
+        memset(line, 0, s * sizeof(uint32_t));
+      } else if (dx < 0) {
+        memmove(line, line + s, (w - s) * sizeof(uint32_t));
+        memset(line + w - s, 0, s * sizeof(uint32_t));
+      }
+    }
+    setRow(y, line);
+  }
+}
+
+//frame time of segment segn in ms, its own frame rate can only be lower than the global one
+uint16_t WS2812FX::getFrameTime(uint8_t segn) {
+  uint8_t fps = _targetFps;
+  if (segn < MAX_NUM_SEGMENTS && _segments[segn].fps && _segments[segn].fps < fps) fps = _segments[segn].fps;
+  return 1000 / fps;
+}
+
 uint8_t WS2812FX::getModeCount()
 {
-  return MODE_COUNT;
+  return MODE_COUNT + _usermodEffectCount;
+}
+
+//effect table entry of effect m, in flash for built-in effects. Read fields with pgm_read_* or memcpy_P
+const WS2812FX::effect_entry* WS2812FX::getEffectEntry(uint8_t m) {
+  if (m < MODE_COUNT) return &_effects[m];
+  if (m - MODE_COUNT < _usermodEffectCount) return &_usermodEffects[m - MODE_COUNT];
+  return &_effects[FX_MODE_STATIC];
+}
+
+uint16_t WS2812FX::runEffect(uint8_t m) {
+  const effect_entry* e = getEffectEntry(m);
+  mode_ptr fn;
+  memcpy_P(&fn, &e->fn, sizeof(fn));
+  if (fn) return (this->*fn)();
+  uint16_t (*ext)(void) = (uint16_t (*)(void))pgm_read_ptr(&e->ext);
+  return ext ? ext() : mode_static();
+}
+
+/*
+ * Adds an effect of a usermod after the built-in ones and returns its id, or 255 if there is no room.
+ * It renders segment getCurrSegmentId() with the public API like a built-in effect and returns the delay to its next frame.
+ * name has to stay valid, a string literal or PROGMEM.
+ */
+uint8_t WS2812FX::addEffect(uint16_t (*fn)(void), const char* name, uint8_t palette, uint8_t flags) {
+  if (!fn || _usermodEffectCount >= MAX_USERMOD_EFFECTS) return 255;
+  effect_entry& e = _usermodEffects[_usermodEffectCount];
+  e.fn = nullptr;
+  e.ext = fn;
+  e.name = name;
+  e.palette = palette;
+  e.data = 0;
+  e.flags = flags;
+  return MODE_COUNT + _usermodEffectCount++;
+}
+
+//name of effect m (PROGMEM)
+const char* WS2812FX::getModeName(uint8_t m) {
+  return (const char*)pgm_read_ptr(&getEffectEntry(m)->name);
 }
 
 uint8_t WS2812FX::getPaletteCount()
@@ -350,9 +788,6 @@ uint8_t WS2812FX::getPaletteCount()
   return 13 + GRADIENT_PALETTE_COUNT;
 }
 
-//TODO effect transitions
-
-
 bool WS2812FX::setEffectConfig(uint8_t m, uint8_t s, uint8_t in, uint8_t p) {
   uint8_t mainSeg = getMainSegmentId();
   Segment& seg = _segments[getMainSegmentId()];
@@ -432,7 +867,7 @@ void WS2812FX::setBrightness(uint8_t b) {
       }
     #endif
   }
-  if (SEGENV.next_time > millis() + 22 && millis() - _lastShow > MIN_SHOW_DELAY) show();//apply brightness change immediately if no refresh soon
+  if (SEGENV.next_time > millis() + 22 && millis() - _lastShow > _minShowDelay) show();//apply brightness change immediately if no refresh soon
 }
 
 uint8_t WS2812FX::getMode(void) {
@@ -474,6 +909,11 @@ uint8_t WS2812FX::getMainSegmentId(void) {
   return 0;
 }
 
+//segment the effect function is rendering
+uint8_t WS2812FX::getCurrSegmentId(void) {
+  return _segment_index;
+}
+
 uint32_t WS2812FX::getColor(void) {
   return _segments[getMainSegmentId()].colors[0];
 }
@@ -506,6 +946,86 @@ WS2812FX::Segment* WS2812FX::getSegments(void) {
   return _segments;
 }
 
+/*
+ * Segment data arena. The data of all segments is kept in one buffer of MAX_SEGMENT_DATA bytes instead of
+ * separate heap blocks, so frequent effect changes can not fragment the heap.
+ * New blocks are put at the top of the arena. If a block does not fit there but the holes left by freed blocks
+ * would make enough room, the blocks in use are moved down first. Effects only access SEGENV.data while they run,
+ * so the blocks of other segments can be moved at any time a block is allocated.
+ */
+byte* WS2812FX::allocateSegmentData(uint16_t len) {
+  if (_usedSegmentData + len > MAX_SEGMENT_DATA) {
+    if (!_modeTransitionCount || _renderingModeTransition) return nullptr;
+    for (uint8_t i = 0; i < MAX_NUM_MODE_TRANSITIONS; i++) { //effects have precedence over crossfades
+      if (_modeTransitions[i].segment != 0xFF) endModeTransition(&_modeTransitions[i]);
+    }
+    if (_usedSegmentData + len > MAX_SEGMENT_DATA) return nullptr;
+  }
+  if (_segmentDataTop + len > MAX_SEGMENT_DATA) compactSegmentData();
+  byte* block = _segmentData + _segmentDataTop;
+  _segmentDataTop += len;
+  _usedSegmentData += len;
+  return block;
+}
+
+void WS2812FX::freeSegmentData(byte* block, uint16_t len) {
+  _usedSegmentData -= len;
+  if (block + len == _segmentData + _segmentDataTop) _segmentDataTop -= len; //no hole if it is the top block
+  if (_usedSegmentData == 0) _segmentDataTop = 0;
+}
+
+//returns the block in use with the lowest address at or above from, nullptr if there is none
+//the lowest block at or above from, nullptr if there is none. Blocks are owned by segments and crossfades
+WS2812FX::Segment_runtime* WS2812FX::nextSegmentDataBlock(byte* from) {
+  Segment_runtime* next = nullptr;
+  for (uint8_t i = 0; i < MAX_NUM_SEGMENTS + MAX_NUM_MODE_TRANSITIONS*2; i++) {
+    Segment_runtime* rt;
+    if (i < MAX_NUM_SEGMENTS) rt = &_segment_runtimes[i];
+    else {
+      mode_transition* t = &_modeTransitions[(i - MAX_NUM_SEGMENTS) >> 1];
+      rt = ((i - MAX_NUM_SEGMENTS) & 1) ? &t->frame : &t->runtime;
+    }
+    byte* d = rt->data;
+    if (d && d >= from && (!next || d < next->data)) next = rt;
+  }
+  return next;
+}
+
+void WS2812FX::compactSegmentData(void) {
+  uint16_t top = 0;
+  Segment_runtime* next;
+  while ((next = nextSegmentDataBlock(_segmentData + top)) != nullptr) {
+    if (next->data != _segmentData + top) {
+      memmove(_segmentData + top, next->data, next->_dataLen);
+      next->data = _segmentData + top;
+    }
+    top += next->_dataLen;
+  }
+  _segmentDataTop = top;
+  _segmentDataCompactions++;
+}
+
+uint16_t WS2812FX::getSegmentDataUsed(void) {
+  return _usedSegmentData;
+}
+
+//largest block that can be allocated without moving data
+uint16_t WS2812FX::getSegmentDataFreeBlock(void) {
+  uint16_t largest = MAX_SEGMENT_DATA - _segmentDataTop;
+  uint16_t pos = 0;
+  Segment_runtime* next;
+  while ((next = nextSegmentDataBlock(_segmentData + pos)) != nullptr) {
+    uint16_t start = next->data - _segmentData;
+    if (start - pos > largest) largest = start - pos;
+    pos = start + next->_dataLen;
+  }
+  return largest;
+}
+
+uint16_t WS2812FX::getSegmentDataCompactions(void) {
+  return _segmentDataCompactions;
+}
+
 uint32_t WS2812FX::getLastShow(void) {
   return _lastShow;
 }
@@ -587,9 +1107,11 @@ void WS2812FX::setPixelSegment(uint8_t n)
   if (n < MAX_NUM_SEGMENTS) {
     _segment_index = n;
     _virtualSegmentLength = SEGMENT.length();
+    handle_matrix();
   } else {
     _segment_index = 0;
     _virtualSegmentLength = 0;
+    _xyMap = nullptr;
   }
 }
 
@@ -628,12 +1150,22 @@ void WS2812FX::setTransitionMode(bool t)
 
 /*
  * color blend function
+ * The 8 bit blend works on two channels at once (R+B and W+G), every product fits into its 16 bit lane
  */
 uint32_t WS2812FX::color_blend(uint32_t color1, uint32_t color2, uint16_t blend, bool b16) {
   if(blend == 0)   return color1;
   uint16_t blendmax = b16 ? 0xFFFF : 0xFF;
   if(blend == blendmax) return color2;
-  uint8_t shift = b16 ? 16 : 8;
+
+  if (!b16) {
+    uint32_t rb1 =  color1       & 0x00FF00FF;
+    uint32_t wg1 = (color1 >> 8) & 0x00FF00FF;
+    uint32_t rb2 =  color2       & 0x00FF00FF;
+    uint32_t wg2 = (color2 >> 8) & 0x00FF00FF;
+    uint32_t rb3 = ((rb2 * blend + rb1 * (0xFF - blend)) >> 8) & 0x00FF00FF;
+    uint32_t wg3 =  (wg2 * blend + wg1 * (0xFF - blend))       & 0xFF00FF00;
+    return rb3 | wg3;
+  }
 
   uint32_t w1 = (color1 >> 24) & 0xFF;
   uint32_t r1 = (color1 >> 16) & 0xFF;
@@ -645,10 +1177,10 @@ uint32_t WS2812FX::color_blend(uint32_t color1, uint32_t color2, uint16_t blend,
   uint32_t g2 = (color2 >>  8) & 0xFF;
   uint32_t b2 =  color2        & 0xFF;
 
-  uint32_t w3 = ((w2 * blend) + (w1 * (blendmax - blend))) >> shift;
-  uint32_t r3 = ((r2 * blend) + (r1 * (blendmax - blend))) >> shift;
-  uint32_t g3 = ((g2 * blend) + (g1 * (blendmax - blend))) >> shift;
-  uint32_t b3 = ((b2 * blend) + (b1 * (blendmax - blend))) >> shift;
+  uint32_t w3 = ((w2 * blend) + (w1 * (blendmax - blend))) >> 16;
+  uint32_t r3 = ((r2 * blend) + (r1 * (blendmax - blend))) >> 16;
+  uint32_t g3 = ((g2 * blend) + (g1 * (blendmax - blend))) >> 16;
+  uint32_t b3 = ((b2 * blend) + (b1 * (blendmax - blend))) >> 16;
 
   return ((w3 << 24) | (r3 << 16) | (g3 << 8) | (b3));
 }
@@ -670,12 +1202,22 @@ void WS2812FX::blendPixelColor(uint16_t n, uint32_t color, uint8_t blend)
   setPixelColor(n, color_blend(getPixelColor(n), color, blend));
 }
 
+//channel delta divided by the fade rate, inv from fade_out(). Truncates towards zero like integer division
+inline int fadeDelta(int c1, int c2, uint32_t inv) {
+  if (c2 > c1) return (((uint32_t)(c2 - c1) * inv) >> 24) +1; // if fade isn't complete, make sure delta is at least 1 (fixes rounding issues)
+  if (c2 < c1) return -(int)(((uint32_t)(c1 - c2) * inv) >> 24) -1;
+  return 0;
+}
+
 /*
  * fade out function, higher rate = quicker fade
+ * Each channel moves by (target - current) / (rate + 1.1), with a rounded up reciprocal instead of a division.
+ * Matches exact division. The float code it replaced gave 1 less for some whole quotients, e.g. 243 / 8.1 (tools/bench_color_kernels.cpp)
  */
 void WS2812FX::fade_out(uint8_t rate) {
   rate = (255-rate) >> 1;
-  float mappedRate = float(rate) +1.1;
+  uint32_t divisor = rate * 10 + 11;             // (rate + 1.1) * 10
+  uint32_t inv = ((10UL << 24) + divisor -1) / divisor; // (delta * inv) >> 24 == delta * 10 / divisor for deltas up to 255
 
   uint32_t color = SEGCOLOR(1); // target color
   int w2 = (color >> 24) & 0xff;
@@ -690,44 +1232,31 @@ void WS2812FX::fade_out(uint8_t rate) {
     int g1 = (color >>  8) & 0xff;
     int b1 =  color        & 0xff;
 
-    int wdelta = (w2 - w1) / mappedRate;
-    int rdelta = (r2 - r1) / mappedRate;
-    int gdelta = (g2 - g1) / mappedRate;
-    int bdelta = (b2 - b1) / mappedRate;
-
-    // if fade isn't complete, make sure delta is at least 1 (fixes rounding issues)
-    wdelta += (w2 == w1) ? 0 : (w2 > w1) ? 1 : -1;
-    rdelta += (r2 == r1) ? 0 : (r2 > r1) ? 1 : -1;
-    gdelta += (g2 == g1) ? 0 : (g2 > g1) ? 1 : -1;
-    bdelta += (b2 == b1) ? 0 : (b2 > b1) ? 1 : -1;
-
-    setPixelColor(i, r1 + rdelta, g1 + gdelta, b1 + bdelta, w1 + wdelta);
+    setPixelColor(i, r1 + fadeDelta(r1, r2, inv), g1 + fadeDelta(g1, g2, inv), b1 + fadeDelta(b1, b2, inv), w1 + fadeDelta(w1, w2, inv));
   }
 }
 
 /*
  * blurs segment content, source: FastLED colorutils.cpp
+ * Works on R+B and G packed into 16 bit lanes and reads every pixel only once. White is cleared like before.
  */
 void WS2812FX::blur(uint8_t blur_amount)
 {
-  uint8_t keep = 255 - blur_amount;
-  uint8_t seep = blur_amount >> 1;
-  CRGB carryover = CRGB::Black;
+  uint16_t keep = 256 - blur_amount;       // nscale8() scales by (scale +1) / 256
+  uint16_t seep = (blur_amount >> 1) +1;
+  uint32_t carryover = 0;
+  uint32_t prev = 0;
   for(uint16_t i = 0; i < SEGLEN; i++)
   {
-    CRGB cur = col_to_crgb(getPixelColor(i));
-    CRGB part = cur;
-    part.nscale8(seep);
-    cur.nscale8(keep);
-    cur += carryover;
-    if(i > 0) {
-      uint32_t c = getPixelColor(i-1);
-      uint8_t r = (c >> 16 & 0xFF);
-      uint8_t g = (c >> 8  & 0xFF);
-      uint8_t b = (c       & 0xFF);
-      setPixelColor(i-1, qadd8(r, part.red), qadd8(g, part.green), qadd8(b, part.blue));
-    }
-    setPixelColor(i,cur.red, cur.green, cur.blue);
+    uint32_t c = getPixelColor(i);
+    uint32_t rb = c & 0x00FF00FF;
+    uint32_t g  = (c >> 8) & 0xFF;
+    uint32_t part = (((rb * seep) >> 8) & 0x00FF00FF) | (((g * seep) >> 8) << 8);
+    uint32_t cur  = (((rb * keep) >> 8) & 0x00FF00FF) | (((g * keep) >> 8) << 8);
+    cur += carryover;  // can not overflow, keep + seep <= 256
+    if(i > 0) setPixelColor(i-1, addSeep(prev, part)); //the part that seeps into the previous pixel
+    setPixelColor(i, cur);
+    prev = cur;
     carryover = part;
   }
 }
@@ -815,110 +1344,139 @@ CRGB WS2812FX::col_to_crgb(uint32_t color)
 }
 
 
-void WS2812FX::load_gradient_palette(uint8_t index)
+void WS2812FX::load_gradient_palette(uint8_t index, CRGBPalette16& target)
 {
   byte i = constrain(index, 0, GRADIENT_PALETTE_COUNT -1);
   byte tcp[72]; //support gradient palettes with up to 18 entries
   memcpy_P(tcp, (byte*)pgm_read_dword(&(gGradientPalettes[i])), 72);
-  targetPalette.loadDynamicGradientPalette(tcp);
+  target.loadDynamicGradientPalette(tcp);
 }
 
 
 /*
- * FastLED palette modes helper function. Limitation: Due to memory reasons, multiple active segments with FastLED will disable the Palette transitions
+ * FastLED palette modes helper function. Every segment keeps its own palette, which is only rebuilt
+ * if the palette or the colors it is made from change, and blended towards the new one if palette fade is enabled.
  */
 void WS2812FX::handle_palette(void)
 {
-  bool singleSegmentMode = (_segment_index == _segment_index_palette_last);
-  _segment_index_palette_last = _segment_index;
+  segment_palette* pal = &_segment_palettes[_segment_index];
 
   byte paletteIndex = SEGMENT.palette;
-  if (paletteIndex == 0) //default palette. Differs depending on effect
+  if (paletteIndex == 0) //default palette. Differs depending on effect, 0 if the effect has none
   {
-    switch (SEGMENT.mode)
-    {
-      case FX_MODE_FIRE_2012  : paletteIndex = 35; break; //heat palette
-      case FX_MODE_COLORWAVES : paletteIndex = 26; break; //landscape 33
-      case FX_MODE_FILLNOISE8 : paletteIndex =  9; break; //ocean colors
-      case FX_MODE_NOISE16_1  : paletteIndex = 20; break; //Drywet
-      case FX_MODE_NOISE16_2  : paletteIndex = 43; break; //Blue cyan yellow
-      case FX_MODE_NOISE16_3  : paletteIndex = 35; break; //heat palette
-      case FX_MODE_NOISE16_4  : paletteIndex = 26; break; //landscape 33
-      case FX_MODE_GLITTER    : paletteIndex = 11; break; //rainbow colors
-      case FX_MODE_SUNRISE    : paletteIndex = 35; break; //heat palette
-      case FX_MODE_FLOW       : paletteIndex =  6; break; //party
+    paletteIndex = pgm_read_byte(&getEffectEntry(SEGMENT.mode)->palette);
+  }
+
+  bool changed = (paletteIndex != pal->index);
+  if (paletteIndex >= 2 && paletteIndex <= 5) { //made from the segment colors
+    for (uint8_t c = 0; c < 3; c++) {
+      if (SEGCOLOR(c) != pal->colors[c]) changed = true;
+      pal->colors[c] = SEGCOLOR(c);
     }
   }
-  if (SEGMENT.mode >= FX_MODE_METEOR && paletteIndex == 0) paletteIndex = 4;
+  if (paletteIndex == 1 && millis() - pal->lastChange > 1000 + ((uint32_t)(255-SEGMENT.intensity))*100) changed = true;
   
-  switch (paletteIndex)
-  {
-    case 0: //default palette. Exceptions for specific effects above
-      targetPalette = PartyColors_p; break;
-    case 1: {//periodically replace palette with a random one. Doesn't work with multiple FastLED segments
-      if (!singleSegmentMode)
-      {
-        targetPalette = PartyColors_p; break; //fallback
-      }
-      if (millis() - _lastPaletteChange > 1000 + ((uint32_t)(255-SEGMENT.intensity))*100)
-      {
+  if (changed) {
+    CRGBPalette16 &targetPalette = pal->target;
+    switch (paletteIndex)
+    {
+      case 0: //default palette. Exceptions for specific effects above
+        targetPalette = PartyColors_p; break;
+      case 1: //periodically replace palette with a random one
         targetPalette = CRGBPalette16(
                         CHSV(random8(), 255, random8(128, 255)),
                         CHSV(random8(), 255, random8(128, 255)),
                         CHSV(random8(), 192, random8(128, 255)),
                         CHSV(random8(), 255, random8(128, 255)));
-        _lastPaletteChange = millis();
-      } break;}
-    case 2: {//primary color only
-      CRGB prim = col_to_crgb(SEGCOLOR(0));
-      targetPalette = CRGBPalette16(prim); break;}
-    case 3: {//primary + secondary
-      CRGB prim = col_to_crgb(SEGCOLOR(0));
-      CRGB sec  = col_to_crgb(SEGCOLOR(1));
-      targetPalette = CRGBPalette16(prim,prim,sec,sec); break;}
-    case 4: {//primary + secondary + tertiary
-      CRGB prim = col_to_crgb(SEGCOLOR(0));
-      CRGB sec  = col_to_crgb(SEGCOLOR(1));
-      CRGB ter  = col_to_crgb(SEGCOLOR(2));
-      targetPalette = CRGBPalette16(ter,sec,prim); break;}
-    case 5: {//primary + secondary (+tert if not off), more distinct
-      CRGB prim = col_to_crgb(SEGCOLOR(0));
-      CRGB sec  = col_to_crgb(SEGCOLOR(1));
-      if (SEGCOLOR(2)) {
-        CRGB ter = col_to_crgb(SEGCOLOR(2));
-        targetPalette = CRGBPalette16(prim,prim,prim,prim,prim,sec,sec,sec,sec,sec,ter,ter,ter,ter,ter,prim);
-      } else {
-        targetPalette = CRGBPalette16(prim,prim,prim,prim,prim,prim,prim,prim,sec,sec,sec,sec,sec,sec,sec,sec);
-      }
-      break;}
-    case 6: //Party colors
-      targetPalette = PartyColors_p; break;
-    case 7: //Cloud colors
-      targetPalette = CloudColors_p; break;
-    case 8: //Lava colors
-      targetPalette = LavaColors_p; break;
-    case 9: //Ocean colors
-      targetPalette = OceanColors_p; break;
-    case 10: //Forest colors
-      targetPalette = ForestColors_p; break;
-    case 11: //Rainbow colors
-      targetPalette = RainbowColors_p; break;
-    case 12: //Rainbow stripe colors
-      targetPalette = RainbowStripeColors_p; break;
-    default: //progmem palettes
-      load_gradient_palette(paletteIndex -13);
+        pal->lastChange = millis();
+        break;
+      case 2: {//primary color only
+        CRGB prim = col_to_crgb(SEGCOLOR(0));
+        targetPalette = CRGBPalette16(prim); break;}
+      case 3: {//primary + secondary
+        CRGB prim = col_to_crgb(SEGCOLOR(0));
+        CRGB sec  = col_to_crgb(SEGCOLOR(1));
+        targetPalette = CRGBPalette16(prim,prim,sec,sec); break;}
+      case 4: {//primary + secondary + tertiary
+        CRGB prim = col_to_crgb(SEGCOLOR(0));
+        CRGB sec  = col_to_crgb(SEGCOLOR(1));
+        CRGB ter  = col_to_crgb(SEGCOLOR(2));
+        targetPalette = CRGBPalette16(ter,sec,prim); break;}
+      case 5: {//primary + secondary (+tert if not off), more distinct
+        CRGB prim = col_to_crgb(SEGCOLOR(0));
+        CRGB sec  = col_to_crgb(SEGCOLOR(1));
+        if (SEGCOLOR(2)) {
+          CRGB ter = col_to_crgb(SEGCOLOR(2));
+          targetPalette = CRGBPalette16(prim,prim,prim,prim,prim,sec,sec,sec,sec,sec,ter,ter,ter,ter,ter,prim);
+        } else {
+          targetPalette = CRGBPalette16(prim,prim,prim,prim,prim,prim,prim,prim,sec,sec,sec,sec,sec,sec,sec,sec);
+        }
+        break;}
+      case 6: //Party colors
+        targetPalette = PartyColors_p; break;
+      case 7: //Cloud colors
+        targetPalette = CloudColors_p; break;
+      case 8: //Lava colors
+        targetPalette = LavaColors_p; break;
+      case 9: //Ocean colors
+        targetPalette = OceanColors_p; break;
+      case 10: //Forest colors
+        targetPalette = ForestColors_p; break;
+      case 11: //Rainbow colors
+        targetPalette = RainbowColors_p; break;
+      case 12: //Rainbow stripe colors
+        targetPalette = RainbowStripeColors_p; break;
+      default: //progmem palettes
+        load_gradient_palette(paletteIndex -13, targetPalette);
+    }
+    pal->index = paletteIndex;
+
+    if (paletteFade && SEGENV.call > 0) {
+      pal->fading = true;
+    } else {
+      pal->current = targetPalette;
+      pal->fading = false;
+      pal->lutValid = false;
+    }
   }
-  
-  if (singleSegmentMode && paletteFade && SEGENV.call > 0) //only blend if just one segment uses FastLED mode
-  {
-    nblendPaletteTowardPalette(currentPalette, targetPalette, 48);
-  } else
-  {
-    currentPalette = targetPalette;
+
+  if (pal->fading) {
+    nblendPaletteTowardPalette(pal->current, pal->target, 48);
+    pal->fading = (pal->current != pal->target);
+    pal->lutValid = false;
   }
 }
 
 
+//scales a palette color by pbri with the same rounding as ColorFromPalette()
+inline uint32_t paletteColor(CRGB c, uint8_t pbri)
+{
+  if (pbri != 255) {
+    uint16_t scale = pbri ? pbri + 2 : 0;
+    c.red   = (c.red   * scale) >> 8;
+    c.green = (c.green * scale) >> 8;
+    c.blue  = (c.blue  * scale) >> 8;
+  }
+  return ((uint32_t)c.red << 16) | ((uint32_t)c.green << 8) | c.blue;
+}
+
+
+//expands the palette of the current segment to 256 colors, only after it has changed. Returns nullptr if out of memory
+CRGB* WS2812FX::getPaletteLUT(void)
+{
+  segment_palette* pal = &_segment_palettes[_segment_index];
+  if (pal->lutValid && pal->lutBlend == paletteBlend) return pal->lut;
+  if (!pal->lut) pal->lut = (CRGB*)malloc(256 * sizeof(CRGB));
+  if (!pal->lut) return nullptr;
+
+  TBlendType blendType = (paletteBlend == 3)? NOBLEND:LINEARBLEND;
+  for (uint16_t i = 0; i < 256; i++) pal->lut[i] = ColorFromPalette(pal->current, i, 255, blendType);
+  pal->lutValid = true;
+  pal->lutBlend = paletteBlend;
+  return pal->lut;
+}
+
+
 /*
  * Gets a single color from the currently selected palette.
  * @param i Palette Index (if mapping is true, the full palette will be SEGLEN long, if false, 255). Will wrap around automatically.
@@ -944,10 +1502,74 @@ uint32_t WS2812FX::color_from_palette(uint16_t i, bool mapping, bool wrap, uint8
   uint8_t paletteIndex = i;
   if (mapping) paletteIndex = (i*255)/(SEGLEN -1);
   if (!wrap) paletteIndex = scale8(paletteIndex, 240); //cut off blend at palette "end"
-  CRGB fastled_col;
-  fastled_col = ColorFromPalette( currentPalette, paletteIndex, pbri, (paletteBlend == 3)? NOBLEND:LINEARBLEND);
 
-  return crgb_to_col(fastled_col);
+  CRGB* lut = getPaletteLUT();
+  if (!lut) return crgb_to_col(ColorFromPalette(SEGPALETTE, paletteIndex, pbri, (paletteBlend == 3)? NOBLEND:LINEARBLEND));
+
+  return paletteColor(lut[paletteIndex], pbri);
+}
+
+
+/*
+ * Gets the palette colors for count palette indexes at once.
+ * Same as color_from_palette(index[n], false, true, mcol, bri[n]), the palette is looked up only once.
+ * @param bri Brightness per index, nullptr for full brightness
+ */
+void WS2812FX::colors_from_palette(const uint8_t* index, const uint8_t* bri, uint32_t* colors, uint16_t count, uint8_t mcol)
+{
+  if (SEGMENT.palette == 0 && mcol < 3) {
+    for (uint16_t n = 0; n < count; n++) {
+      colors[n] = bri ? color_from_palette(0, false, true, mcol, bri[n]) : SEGCOLOR(mcol);
+    }
+    return;
+  }
+
+  CRGB* lut = getPaletteLUT();
+  if (!lut) {
+    TBlendType blendType = (paletteBlend == 3)? NOBLEND:LINEARBLEND;
+    for (uint16_t n = 0; n < count; n++) {
+      colors[n] = crgb_to_col(ColorFromPalette(SEGPALETTE, index[n], bri ? bri[n] : 255, blendType));
+    }
+    return;
+  }
+
+  if (bri) {
+    for (uint16_t n = 0; n < count; n++) colors[n] = paletteColor(lut[index[n]], bri[n]);
+  } else {
+    for (uint16_t n = 0; n < count; n++) colors[n] = crgb_to_col(lut[index[n]]);
+  }
+}
+
+
+//sets count pixels starting at first to the palette colors of index (and bri, see colors_from_palette())
+void WS2812FX::setPixelsFromPalette(uint16_t first, uint16_t count, const uint8_t* index, const uint8_t* bri, uint8_t mcol)
+{
+  uint32_t colors[PALETTE_SPAN];
+  while (count) {
+    uint16_t n = MIN(count, PALETTE_SPAN);
+    colors_from_palette(index, bri, colors, n, mcol);
+    for (uint16_t i = 0; i < n; i++) setPixelColor(first + i, colors[i]);
+    first += n; count -= n; index += n;
+    if (bri) bri += n;
+  }
+}
+
+
+/*
+ * Palette indexes of pixels first to first+count-1 if the palette is stretched over len pixels: (i*255)/len + offset.
+ * Steps from pixel to pixel with the remainder instead of dividing for every pixel.
+ */
+void WS2812FX::palette_ramp(uint8_t* index, uint16_t first, uint16_t count, uint16_t len, uint8_t offset)
+{
+  if (len == 0) len = 1;
+  uint32_t start = (uint32_t)first * 255;
+  uint16_t q = start / len, r = start % len;
+  uint16_t stepQ = 255 / len, stepR = 255 % len;
+  for (uint16_t n = 0; n < count; n++) {
+    index[n] = q + offset;
+    q += stepQ; r += stepR;
+    if (r >= len) { r -= len; q++; }
+  }
 }
 
 //@returns `true` if color, mode, speed, intensity and palette match
@@ -970,7 +1592,7 @@ bool WS2812FX::segmentsAreIdentical(Segment* a, Segment* b)
 #ifdef WLED_USE_ANALOG_LEDS     
 void WS2812FX::setRgbwPwm(void) {
   uint32_t nowUp = millis(); // Be aware, millis() rolls over every 49 days
-  if (nowUp - _analogLastShow < MIN_SHOW_DELAY) return;
+  if (nowUp - _analogLastShow < _minShowDelay) return;
 
   _analogLastShow = nowUp;
 
@@ -33,7 +33,13 @@ void handleAlexa()
   espalexa.loop();
 }
 
+//called from the web server, the change is applied with the next frame
 void onAlexaChange(EspalexaDevice* dev)
+{
+  if (!postStateChange(STATE_CMD_ALEXA, nullptr, 0)) applyAlexaChange();
+}
+
+void applyAlexaChange()
 {
   EspalexaDeviceProperty m = espalexaDevice->getLastChangedProperty();
   
@@ -95,4 +101,5 @@ void onAlexaChange(EspalexaDevice* dev)
 #else
  void alexaInit(){}
  void handleAlexa(){}
+ void applyAlexaChange(){}
 #endif
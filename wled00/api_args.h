@@ -0,0 +1,115 @@
+#ifndef WLED_API_ARGS_H
+#define WLED_API_ARGS_H
+
+/*
+ * Single pass tokenizer for HTTP API requests like "win&A=128&FX=3&SR".
+ * All API keys are one or two characters long. Each key is stored once in a small
+ * open addressing hash table (linear probing) together with the position of its value in the request,
+ * so handleSet() looks up a key in a probe or two instead of scanning the request.
+ * Keys after the first API_ARGS_SLOTS -1 distinct ones of a request are dropped.
+ * tools/bench_api_args.cpp compares it with the indexOf() scanning it replaced.
+ */
+#define API_ARGS_SLOTS   32      //must be a power of 2
+#define API_ARG_NO_VALUE 0xFFFF  //key given without "="
+
+class ApiArgs {
+  public:
+    ApiArgs(const char* req) : _req(req), _count(0)
+    {
+      memset(_slots, 0, sizeof(_slots));
+      const char* tok = req;
+      while (*tok) {
+        const char* end = tok;
+        while (*end && *end != '&') end++;
+        const char* eq = tok;
+        while (eq < end && *eq != '=') eq++;
+        uint8_t keyLen = eq - tok;
+        if (keyLen == 1 || keyLen == 2) {
+          uint16_t key = ((uint8_t)tok[0] << 8) | ((keyLen == 2) ? (uint8_t)tok[1] : 0);
+          insert(key, (eq < end) ? (eq +1 - req) : API_ARG_NO_VALUE);
+        }
+        tok = (*end) ? end +1 : end;
+      }
+    }
+
+    //returns the value string of key (terminated by '&' or end of request) or nullptr if not given as "key=value"
+    const char* get(const char* key)
+    {
+      int8_t s = find(code(key));
+      if (s < 0 || _slots[s].pos == API_ARG_NO_VALUE) return nullptr;
+      return _req + _slots[s].pos;
+    }
+
+    const char* get(const __FlashStringHelper* key)
+    {
+      int8_t s = find(code(key));
+      if (s < 0 || _slots[s].pos == API_ARG_NO_VALUE) return nullptr;
+      return _req + _slots[s].pos;
+    }
+
+    //true if key is present in the request, with or without a value
+    bool has(const char* key)
+    {
+      return find(code(key)) >= 0;
+    }
+
+    bool has(const __FlashStringHelper* key)
+    {
+      return find(code(key)) >= 0;
+    }
+
+  private:
+    struct {
+      uint16_t key; //0 if empty
+      uint16_t pos;
+    } _slots[API_ARGS_SLOTS];
+    const char* _req;
+    uint8_t _count;
+
+    static uint16_t code(const char* key)
+    {
+      return ((uint8_t)key[0] << 8) | (key[0] ? (uint8_t)key[1] : 0);
+    }
+
+    static uint16_t code(const __FlashStringHelper* key)
+    {
+      PGM_P k = (PGM_P)key;
+      uint8_t c0 = pgm_read_byte(k);
+      return (c0 << 8) | (c0 ? pgm_read_byte(k +1) : 0);
+    }
+
+    //not collision free, handleSet() knows about twice as many keys as there are slots.
+    //Spreads the keys of typical requests so most lookups need a single probe
+    static uint8_t hash(uint16_t key)
+    {
+      return (((key >> 8) * 3) ^ ((key & 0xFF) * 93)) & (API_ARGS_SLOTS -1);
+    }
+
+    void insert(uint16_t key, uint16_t pos)
+    {
+      uint8_t s = hash(key);
+      while (_slots[s].key) {
+        if (_slots[s].key == key) return; //first occurrence of a key wins
+        s = (s +1) & (API_ARGS_SLOTS -1);
+      }
+      if (_count >= API_ARGS_SLOTS -1) { //keep one slot free so lookups terminate
+        DEBUG_PRINT(F("API arg dropped: "));
+        DEBUG_PRINT((char)(key >> 8)); if (key & 0xFF) DEBUG_PRINT((char)(key & 0xFF));
+        DEBUG_PRINTLN();
+        return;
+      }
+      _slots[s].key = key; _slots[s].pos = pos; _count++;
+    }
+
+    int8_t find(uint16_t key)
+    {
+      uint8_t s = hash(key);
+      while (_slots[s].key) {
+        if (_slots[s].key == key) return s;
+        s = (s +1) & (API_ARGS_SLOTS -1);
+      }
+      return -1;
+    }
+};
+
+#endif
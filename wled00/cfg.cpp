@@ -97,6 +97,8 @@ void deserializeConfig() {
   CJSON(strip.milliampsPerLed, hw_led[F("ledma")]);
   CJSON(strip.reverseMode, hw_led[F("rev")]);
   CJSON(strip.rgbwMode, hw_led[F("rgbwm")]);
+  int fps = hw_led[F("fps")] | (int)strip.getTargetFps();
+  strip.setTargetFps(constrain(fps, 1, WLED_FPS_MAX));
 
   JsonObject hw_led_ins_0 = hw_led[F("ins")][0];
   //bool hw_led_ins_0_en = hw_led_ins_0[F("en")]; // true
@@ -146,6 +148,7 @@ void deserializeConfig() {
   int tdd = light_tr[F("dur")] | -1;
   if (tdd >= 0) transitionDelayDefault = tdd * 100;
   CJSON(strip.paletteFade, light_tr[F("pal")]);
+  CJSON(strip.effectFade, light_tr[F("fx")]);
 
   JsonObject light_nl = light["nl"];
   CJSON(nightlightMode, light_nl[F("mode")]);
@@ -189,6 +192,7 @@ void deserializeConfig() {
   CJSON(notifyHue, if_sync_send[F("hue")]);
   CJSON(notifyMacro, if_sync_send[F("macro")]);
   CJSON(notifyTwice, if_sync_send[F("twice")]);
+  CJSON(strip.deterministicMode, if_sync[F("det")]);
 
   JsonObject if_live = interfaces[F("live")];
   CJSON(receiveDirect, if_live[F("en")]);
@@ -225,6 +229,7 @@ void deserializeConfig() {
   CJSON(mqttEnabled, if_mqtt[F("en")]);
   getStringFromJson(mqttServer, if_mqtt[F("broker")], 33);
   CJSON(mqttPort, if_mqtt[F("port")]); // 1883
+  CJSON(perfMqttInterval, if_mqtt[F("perf")]);
   getStringFromJson(mqttUser, if_mqtt[F("user")], 41);
   getStringFromJson(mqttPass, if_mqtt["psk"], 41); //normally not present due to security
   getStringFromJson(mqttClientID, if_mqtt[F("cid")], 41);
@@ -335,6 +340,7 @@ void deserializeConfig() {
 }
 
 void serializeConfig() {
+  doSerializeConfig = false;
   serializeConfigSec();
 
   DEBUG_PRINTLN(F("Writing settings to /cfg.json..."));
@@ -401,6 +407,7 @@ void serializeConfig() {
   hw_led[F("ledma")] = strip.milliampsPerLed;
   hw_led[F("rev")] = strip.reverseMode;
   hw_led[F("rgbwm")] = strip.rgbwMode;
+  hw_led[F("fps")] = strip.getTargetFps();
 
   JsonArray hw_led_ins = hw_led.createNestedArray("ins");
 
@@ -481,6 +488,7 @@ void serializeConfig() {
   light_tr[F("mode")] = fadeTransition;
   light_tr[F("dur")] = transitionDelayDefault / 100;
   light_tr[F("pal")] = strip.paletteFade;
+  light_tr[F("fx")] = strip.effectFade;
 
   JsonObject light_nl = light.createNestedObject("nl");
   light_nl[F("mode")] = nightlightMode;
@@ -522,6 +530,7 @@ void serializeConfig() {
   if_sync_send[F("hue")] = notifyHue;
   if_sync_send[F("macro")] = notifyMacro;
   if_sync_send[F("twice")] = notifyTwice;
+  if_sync[F("det")] = strip.deterministicMode;
 
   JsonObject if_live = interfaces.createNestedObject("live");
   if_live[F("en")] = receiveDirect;
@@ -553,6 +562,7 @@ void serializeConfig() {
   if_mqtt[F("en")] = mqttEnabled;
   if_mqtt[F("broker")] = mqttServer;
   if_mqtt[F("port")] = mqttPort;
+  if_mqtt[F("perf")] = perfMqttInterval;
   if_mqtt[F("user")] = mqttUser;
   if_mqtt[F("pskl")] = strlen(mqttPass);
   if_mqtt[F("cid")] = mqttClientID;
@@ -635,9 +645,7 @@ void serializeConfig() {
   JsonObject usermods_settings = doc.createNestedObject("um");
   usermods.addToConfig(usermods_settings);
 
-  File f = WLED_FS.open("/cfg.json", "w");
-  if (f) serializeJson(doc, f);
-  f.close();
+  writeFileAtomic("/cfg.json", &doc);
 }
 
 //settings in /wsec.json, not accessible via webserver, for passwords and tokens
@@ -705,7 +713,5 @@ void serializeConfigSec() {
   ota[F("lock-wifi")] = wifiLock;
   ota[F("aota")] = aOtaEnabled;
 
-  File f = WLED_FS.open("/wsec.json", "w");
-  if (f) serializeJson(doc, f);
-  f.close();
+  writeFileAtomic("/wsec.json", &doc);
 }
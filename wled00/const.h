@@ -205,4 +205,69 @@
   #define JSON_BUFFER_SIZE 16384
 #endif
 
+// Documents up to this size are allocated per request, larger ones use the shared JSON buffer
+#define JSON_SMALL_DOC_SIZE 1024
+
+// Presets kept in the RAM cache (number of presets and total size of their serialized JSON)
+#ifndef PRESET_CACHE_SIZE
+  #define PRESET_CACHE_SIZE 8
+#endif
+#ifdef ESP8266
+  #define PRESET_CACHE_MAX_BYTES 3072
+#else
+  #define PRESET_CACHE_MAX_BYTES 12288
+#endif
+
+// presets.json is compacted when at least this percentage (and PRESET_COMPACT_MIN_SPACE bytes) of it is whitespace
+// left over from deleted presets and no preset was saved for PRESET_COMPACT_IDLE ms
+#define PRESET_COMPACT_THRESHOLD 25
+#define PRESET_COMPACT_MIN_SPACE 1024
+#define PRESET_COMPACT_IDLE 10000
+
+// Preset and config writes are deferred until there were no further changes for WRITE_COALESCE_IDLE ms,
+// but at most for WRITE_COALESCE_MAX ms. Up to PENDING_PRESET_WRITES presets can be pending
+#define WRITE_COALESCE_IDLE 2000
+#define WRITE_COALESCE_MAX 10000
+#define PENDING_PRESET_WRITES 8
+
+// Playlists
+#ifdef ESP8266
+  #define PLAYLIST_MAX_ENTRIES 1000
+#else
+  #define PLAYLIST_MAX_ENTRIES 4000
+#endif
+#define PLAYLIST_MAX_DEPTH 3       // levels of playlists nested in playlists that are resolved
+#define PLAYLIST_PREFETCH 1000     // ms before the next entry is due that its preset is loaded into RAM
+
+// Scheduler
+#define SCHEDULER_SLOTS 8          // max. number of pending events
+#define SCHEDULER_MAX_IDLE 4       // max. ms the loop sleeps while waiting for the next frame or event
+#define SCHEDULER_PAUSE_RETRY 100  // ms until a paused event (e.g. playlist during realtime) is retried
+
+#define TASK_MAX_POSTPONE 4        // max. number of loops in a row a task is postponed to render a frame on time
+
+#define EVENT_PLAYLIST      1
+#define EVENT_PRESET_CYCLE  2
+#define EVENT_TIMERS        3
+
+// State change queue and render task (ESP32 with WLED_ENABLE_RENDER_TASK)
+#define STATE_QUEUE_SIZE 8         // queued state changes, one slot stays empty
+#define STATE_CMD_TIMEOUT 100      // max. ms a network callback waits for its state change to be applied
+#define RENDER_TASK_CORE 1         // application core, WiFi and the TCP stack run on core 0
+#define RENDER_TASK_PRIORITY 2     // above loop() (1) so frames are rendered on time
+#define RENDER_TASK_STACK 8192
+#define RENDER_TASK_MAX_WAIT 20    // max. ms between checks for queued state changes while effects are not running
+
+#define STATE_CMD_JSON  0
+#define STATE_CMD_HTTP  1
+#define STATE_CMD_COLOR 2          // MQTT /col payload
+#define STATE_CMD_BRI   3          // MQTT brightness payload
+#define STATE_CMD_ALEXA 4          // last change of the Alexa device
+#define STATE_CMD_PIXELS 5         // binary pixel block
+
+// Binary pixel block (/json/pixels and binary WebSocket frames)
+#define PIXEL_BLOCK_HEADER_SIZE   4            //segment id, flags, 16 bit start offset
+#define PIXEL_BLOCK_FLAG_RGBW  0x01            //4 bytes per pixel instead of 3
+#define PIXEL_BLOCK_MAX_SIZE (PIXEL_BLOCK_HEADER_SIZE + MAX_LEDS * 4)
+
 #endif
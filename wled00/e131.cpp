@@ -18,9 +18,9 @@ void handleDDPPacket(e131_packet_t* p) {
     int sn = p->sequenceNum & 0xF;
     if (sn) {
       if (lastPushSeq > 5) {
-        if (sn > (lastPushSeq -5) && sn < lastPushSeq) return;
+        if (sn > (lastPushSeq -5) && sn < lastPushSeq) {realtimeDrops++; return;}
       } else {
-        if (sn > (10 + lastPushSeq) || sn < lastPushSeq) return;
+        if (sn > (10 + lastPushSeq) || sn < lastPushSeq) {realtimeDrops++; return;}
       }
     }
   }
@@ -94,6 +94,7 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       DEBUG_PRINT(", universe=");
       DEBUG_PRINT(uni);
       DEBUG_PRINTLN(")");
+      realtimeDrops++;
       return;
     }
   e131LastSequenceNumber[uni-e131Universe] = seq;
@@ -139,7 +140,7 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
         DMXOldDimmer = e131_data[DMXAddress+0];
         bri = e131_data[DMXAddress+0];
       }
-      if (e131_data[DMXAddress+1] < MODE_COUNT)
+      if (e131_data[DMXAddress+1] < strip.getModeCount())
         effectCurrent = e131_data[DMXAddress+ 1];
       effectSpeed     = e131_data[DMXAddress+ 2];  // flickers
       effectIntensity = e131_data[DMXAddress+ 3];
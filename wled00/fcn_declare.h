@@ -13,6 +13,7 @@ void onAlexaChange(EspalexaDevice* dev);
 void alexaInit();
 void handleAlexa();
 void onAlexaChange(EspalexaDevice* dev);
+void applyAlexaChange();
 
 //blynk.cpp
 void initBlynk(const char* auth, const char* host, uint16_t port);
@@ -58,8 +59,14 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol);
 bool handleFileRead(AsyncWebServerRequest*, String path);
 bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content);
 bool writeObjectToFile(const char* file, const char* key, JsonDocument* content);
-bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest);
-bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest);
+bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest, const JsonDocument* filter = nullptr);
+bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest, const JsonDocument* filter = nullptr);
+bool writeFileAtomic(const char* file, JsonDocument* content);
+void recoverFile(const char* file);
+bool presetFileReplaced();
+byte getPresetFileFragmentation();
+bool compactPresetFile();
+void handlePresetCompaction();
 void updateFSInfo();
 void closeFile();
 
@@ -97,11 +104,34 @@ void handleIR();
 #include "src/dependencies/json/AsyncJson-v6.h"
 #include "FX.h"
 
+/*
+ * JSON document for a single request. Documents larger than JSON_SMALL_DOC_SIZE use a shared buffer
+ * that is allocated once and then reused, so large short-lived allocations do not fragment the heap.
+ * If the shared buffer is already in use, the document is allocated on the heap instead.
+ */
+class PooledJsonDoc {
+  public:
+    PooledJsonDoc(size_t capacity);
+    ~PooledJsonDoc();
+    JsonDocument* get() { return _doc; }
+    JsonDocument& operator*() { return *_doc; }
+    JsonDocument* operator->() { return _doc; }
+  private:
+    JsonDocument* _doc;
+    bool _pooled;
+};
+
+size_t jsonSizeForInput(size_t len);
 void deserializeSegment(JsonObject elem, byte it);
+bool applyPixelBlock(byte id, uint16_t offset, const uint8_t* data, size_t len, bool rgbw);
+bool handlePixelBlock(const uint8_t* payload, size_t len);
+bool postPixelBlock(const uint8_t* payload, size_t len);
+bool postPixels(byte id, uint16_t offset, const uint8_t* data, size_t len, bool rgbw);
 bool deserializeState(JsonObject root);
 void serializeSegment(JsonObject& root, WS2812FX::Segment& seg, byte id, bool forPreset = false, bool segmentBounds = true);
 void serializeState(JsonObject root, bool forPreset = false, bool includeBri = true, bool segmentBounds = true);
 void serializeInfo(JsonObject root);
+void serializeModeNames(Print& dest);
 void serveJson(AsyncWebServerRequest* request);
 bool serveLiveLeds(AsyncWebServerRequest* request, uint32_t wsClient = 0);
 
@@ -116,6 +146,8 @@ void colorUpdated(int callMode);
 void updateInterfaces(uint8_t callMode);
 void handleTransitions();
 void handleNightlight();
+void handlePresetCycle();
+void schedulePresetCycle();
 byte scaledBri(byte in);
 
 //lx_parser.cpp
@@ -124,6 +156,8 @@ void parseLxJson(int lxValue, byte segId, bool secondary);
 
 //mqtt.cpp
 bool initMqtt();
+void parseMQTTBriPayload(char* payload);
+void publishPerf();
 void publishMqtt();
 
 //ntp.cpp
@@ -135,6 +169,7 @@ void getTimeString(char* out);
 bool checkCountdown();
 void setCountdown();
 byte weekdayMondayFirst();
+void scheduleTimers();
 void checkTimers();
 
 //overlay.cpp
@@ -149,6 +184,11 @@ void setCronixie();
 void _overlayCronixie();    
 void _drawOverlayCronixie();
 
+//perf.cpp
+void handlePerf();
+size_t perfDocSize();
+void serializePerf(JsonObject root);
+
 //pin_manager.cpp
 class PinManagerClass {
   private:
@@ -173,19 +213,55 @@ class PinManagerClass {
 //playlist.cpp
 void loadPlaylist(JsonObject playlistObject);
 void handlePlaylist();
+void schedulePlaylist();
 
 //presets.cpp
 bool applyPreset(byte index);
 void savePreset(byte index, bool persist = true, const char* pname = nullptr, JsonObject saveobj = JsonObject());
 void deletePreset(byte index);
+bool readPreset(byte index, JsonDocument* dest);
+void prefetchPreset(byte index);
+void presetCacheClear();
+void flushPresetWrites();
+void clearPresetWrites();
+void handlePresetWrites();
+
+//render.cpp
+void handleStateQueue();
+bool peekStateRequest(const char* data, size_t len, JsonDocument& dest);
+bool postStateChange(byte type, const char* data, size_t len, bool wait = false, uint32_t client = 0);
+void startRenderTask();
+bool renderTaskActive();
+void lockStrip();
+void unlockStrip();
+
+//scheduler.cpp
+struct LoopTask {
+  const char* name;
+  void (*run)();
+  bool unlocked;    //does not touch the LED state, runs concurrently with the render task
+  uint32_t maxUs;
+  uint32_t avgUs;
+  uint32_t runs;
+  uint32_t skips;
+  byte postponed;   //number of loops in a row the task was postponed
+};
+
+void runLoopTasks(LoopTask* tasks, byte count, LoopTask* render);
+void serializeTasks(JsonObject root);
+void scheduleEvent(byte type, uint32_t due);
+void cancelEvent(byte type);
+uint32_t timeToNextEvent();
+void handleEvents();
+void idleUntilNextEvent();
 
 //set.cpp
 void _setRandomColor(bool _sec,bool fromButton=false);
 bool isAsterisksOnly(const char* str, byte maxLen);
 void handleSettingsSet(AsyncWebServerRequest *request, byte subPage);
 bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply=true);
-int getNumVal(const String* req, uint16_t pos);
-bool updateVal(const String* req, const char* key, byte* val, byte minv=0, byte maxv=255);
+int getNumVal(const char* val);
+bool updateVal(const char* val, byte* dest, byte minv=0, byte maxv=255);
 
 //udp.cpp
 void notify(byte callMode, bool followUp=false);
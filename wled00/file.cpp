@@ -31,15 +31,101 @@ uint16_t knownLargestSpace = UINT16_MAX;
 
 File f;
 
+/*
+ * Files are never modified in place. Changes are written to a temporary copy that replaces the original by renaming
+ * once it is complete and synced, so a power loss during a write leaves either the old or the new file, never a broken one.
+ */
+char atomicTarget[33] = ""; //file that the currently open temporary copy replaces when closed
+
+//temporary file name for a file, e.g. /presets.json.tmp
+void getTempFileName(char* dest, const char* file) {
+  snprintf_P(dest, 33, PSTR("%s.tmp"), file);
+}
+
+//replaces file with tmp. Not all filesystems allow renaming onto an existing file
+bool replaceFile(const char* tmp, const char* file) {
+  if (WLED_FS.rename(tmp, file)) return true;
+  WLED_FS.remove(file);
+  return WLED_FS.rename(tmp, file);
+}
+
+bool copyFile(const char* src, const char* dst) {
+  File s = WLED_FS.open(src, "r");
+  if (!s) return false;
+  File d = WLED_FS.open(dst, "w");
+  if (!d) {
+    s.close();
+    return false;
+  }
+  byte buf[FS_BUFSIZE];
+  size_t len = 0;
+  bool success = true;
+  while (success && (len = s.read(buf, FS_BUFSIZE)) > 0) {
+    success = (d.write(buf, len) == len);
+  }
+  success = success && (d.size() == s.size());
+  d.close();
+  s.close();
+  return success;
+}
+
 //wrapper to find out how long closing takes
 void closeFile() {
   DEBUGFS_PRINT(F("Close -> "));
   uint32_t s = millis();
-  f.close();
+  if (atomicTarget[0]) {
+    char tmp[33];
+    getTempFileName(tmp, atomicTarget);
+    f.flush();
+    f.close();
+    if (!replaceFile(tmp, atomicTarget)) errorFlag = ERR_FS_GENERAL;
+    atomicTarget[0] = 0;
+  } else {
+    f.close();
+  }
   DEBUGFS_PRINTF("took %d ms\n", millis() - s);
   doCloseFile = false;
 }
 
+//serializes content to file, replacing it atomically
+bool writeFileAtomic(const char* file, JsonDocument* content) {
+  if (doCloseFile) closeFile();
+  char tmp[33];
+  getTempFileName(tmp, file);
+  File t = WLED_FS.open(tmp, "w");
+  if (!t) return false;
+  size_t len = serializeJson(*content, t);
+  t.flush();
+  bool success = (len > 0 && t.size() == len);
+  t.close();
+  if (success) success = replaceFile(tmp, file);
+  else WLED_FS.remove(tmp);
+  return success;
+}
+
+//finishes a replacement that was interrupted by a reset (original already removed but temporary copy not renamed yet)
+//and removes left over temporary files from interrupted writes. The temporary copy is only used if it is a complete JSON object
+void recoverFile(const char* file) {
+  char tmp[33];
+  getTempFileName(tmp, file);
+  if (!WLED_FS.exists(tmp)) return;
+  if (!WLED_FS.exists(file)) {
+    File t = WLED_FS.open(tmp, "r");
+    bool valid = false;
+    if (t) {
+      StaticJsonDocument<16> filter; //empty object, parses the whole file without keeping any of it
+      filter.to<JsonObject>();
+      StaticJsonDocument<16> doc;
+      DeserializationError error = deserializeJson(doc, t, DeserializationOption::Filter(filter));
+      valid = !error && doc.is<JsonObject>();
+      t.close();
+    }
+    if (valid && WLED_FS.rename(tmp, file)) return;
+    DEBUGFS_PRINTLN(F("Incomplete temporary file"));
+  }
+  WLED_FS.remove(tmp);
+}
+
 //find() that reads and buffers data from file stream in 256-byte blocks.
 //Significantly faster, f.find(key) can take SECONDS for multi-kB files
 bool bufferedFind(const char *target, bool fromStart = true) {
@@ -177,6 +263,162 @@ void writeSpace(uint16_t l)
   if (knownLargestSpace < l) knownLargestSpace = l;
 }
 
+/*
+ * In-RAM index of the root-level objects in presets.json (preset ID -> file offset and length of the object).
+ * It is built with a single pass over the file on first access and updated by writeObjectToFile(),
+ * so recalling a preset is a single seek instead of a scan of the whole file.
+ * The file size and the key in front of an indexed object are checked before use,
+ * so an index that went stale (e.g. file replaced via the editor) is rebuilt instead of returning wrong data.
+ */
+struct FileIndexEntry {
+  uint32_t pos;   //position of the opening '{' of the object
+  uint16_t len;   //length of the object including braces
+  uint16_t id;
+};
+
+FileIndexEntry* presetIndex = nullptr;
+uint16_t presetIndexCount = 0;
+uint16_t presetIndexAlloc = 0;
+uint32_t presetIndexFileSize = 0;
+bool presetIndexValid = false;
+bool indexedWrite = false; //the file currently written to is the preset file
+uint32_t presetFileSpace = 0; //whitespace between objects (left over from deleted or shrunk presets)
+uint32_t presetFileLastWrite = 0;
+
+bool isIndexedFile(const char* file) {
+  return file && strcmp_P(file, PSTR("/presets.json")) == 0;
+}
+
+void invalidatePresetIndex() {
+  presetIndexValid = false;
+  presetIndexCount = 0;
+}
+
+FileIndexEntry* presetIndexFind(uint16_t id) {
+  for (uint16_t i = 0; i < presetIndexCount; i++) {
+    if (presetIndex[i].id == id) return &presetIndex[i];
+  }
+  return nullptr;
+}
+
+void presetIndexSet(uint16_t id, uint32_t pos, uint32_t len) {
+  if (!presetIndexValid) return;
+  FileIndexEntry* e = presetIndexFind(id);
+  if (!e) {
+    if (presetIndexCount >= presetIndexAlloc) {
+      FileIndexEntry* grown = (FileIndexEntry*)realloc(presetIndex, (presetIndexAlloc + 16) * sizeof(FileIndexEntry));
+      if (!grown) { invalidatePresetIndex(); return; } //out of memory, fall back to scanning
+      presetIndex = grown;
+      presetIndexAlloc += 16;
+    }
+    e = &presetIndex[presetIndexCount++];
+    e->id = id;
+  }
+  e->pos = pos;
+  e->len = len;
+}
+
+void presetIndexRemove(uint16_t id) {
+  if (!presetIndexValid) return;
+  FileIndexEntry* e = presetIndexFind(id);
+  if (!e) return;
+  *e = presetIndex[--presetIndexCount]; //order does not matter
+}
+
+//true if presets.json has a different size than the indexed one, it was replaced outside of writeObjectToFile()
+bool presetFileReplaced() {
+  if (!presetIndexValid) return false;
+  if (doCloseFile) closeFile(); //a file kept open for consecutive writes may not be flushed yet
+  File pf = WLED_FS.open("/presets.json", "r");
+  if (!pf) return true;
+  bool replaced = presetIndexFileSize != pf.size();
+  pf.close();
+  return replaced;
+}
+
+//single pass over the open file, records position and length of all root-level objects with a numeric key
+bool buildPresetIndex() {
+  #ifdef WLED_DEBUG_FS
+    DEBUGFS_PRINTLN(F("Build index"));
+    uint32_t s = millis();
+  #endif
+  invalidatePresetIndex();
+  if (!f) return false;
+  presetIndexValid = true;
+
+  byte buf[FS_BUFSIZE];
+  uint16_t depth = 0, bufsize = 0;
+  bool inStr = false, esc = false, keyIsNum = false;
+  uint16_t keyNum = 0, objId = 0;
+  uint32_t objStart = 0, base = 0;
+  bool inObj = false;
+  presetFileSpace = 0;
+
+  f.seek(0);
+  while ((bufsize = f.read(buf, FS_BUFSIZE)) > 0) {
+    for (uint16_t i = 0; i < bufsize; i++) {
+      byte c = buf[i];
+      if (inStr) {
+        if (esc) esc = false;
+        else if (c == '\\') esc = true;
+        else if (c == '"') inStr = false;
+        else if (depth == 1) {
+          if (c >= '0' && c <= '9') keyNum = keyNum*10 + (c - '0');
+          else keyIsNum = false;
+        }
+        continue;
+      }
+      switch (c) {
+        case ' ': case '\n': case '\r': case '\t': presetFileSpace++; break;
+        case '"': inStr = true; if (depth == 1) { keyNum = 0; keyIsNum = true; } break;
+        case ',': if (depth == 1) keyIsNum = false; break;
+        case '{':
+          if (depth == 1 && keyIsNum) { inObj = true; objId = keyNum; objStart = base + i; }
+          depth++; break;
+        case '}':
+          if (depth) depth--;
+          if (depth == 1 && inObj) {
+            presetIndexSet(objId, objStart, base + i + 1 - objStart);
+            inObj = false; keyIsNum = false;
+          }
+          break;
+      }
+    }
+    base += bufsize;
+  }
+  presetIndexFileSize = f.size();
+  DEBUGFS_PRINTF("Indexed %d objects, took %d ms\n", presetIndexCount, millis() - s);
+  return presetIndexValid;
+}
+
+//bufferedFind() for the preset file: leaves the file pos at the start of the object, like bufferedFind() does.
+//objLen is set to the length of the object if known from the index, 0 otherwise
+bool indexedFind(const char *key, uint32_t *objLen) {
+  *objLen = 0;
+  if (presetIndexValid && presetIndexFileSize != f.size()) { //replaced outside of writeObjectToFile(), e.g. via /edit
+    DEBUGFS_PRINTLN(F("Preset file changed"));
+    presetCacheClear();
+    clearPresetWrites(); //queued changes were made to the replaced file
+  }
+  if ((!presetIndexValid || presetIndexFileSize != f.size()) && !buildPresetIndex()) return bufferedFind(key);
+
+  FileIndexEntry* e = presetIndexFind(atoi(key +1));
+  if (!e) return false;
+
+  char buf[10];
+  size_t keyLen = strlen(key);
+  if (keyLen < sizeof(buf) && e->pos >= keyLen && e->pos + e->len <= f.size()) {
+    f.seek(e->pos - keyLen);
+    if (f.read((uint8_t*)buf, keyLen) == keyLen && strncmp(buf, key, keyLen) == 0) {
+      *objLen = e->len;
+      return true;
+    }
+  }
+  DEBUGFS_PRINTLN(F("Index stale"));
+  invalidatePresetIndex();
+  return bufferedFind(key);
+}
+
 bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint32_t contentLen = 0)
 {
   #ifdef WLED_DEBUG_FS
@@ -201,9 +443,15 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   if (!contentLen) contentLen = measureJson(*content);
   DEBUGFS_PRINTF("CLen %d\n", contentLen);
   if (bufferedFindSpace(contentLen + strlen(key) + 1)) {
+    uint32_t start = f.position();
     if (f.position() > 2) f.write(','); //add comma if not first object
     f.print(key);
+    if (indexedWrite) presetIndexSet(atoi(key +1), f.position(), contentLen);
     serializeJson(*content, f);
+    if (indexedWrite) {
+      presetIndexFileSize = f.size();
+      presetFileSpace -= min(presetFileSpace, (uint32_t)(f.position() - start));
+    }
     DEBUGFS_PRINTF("Inserted, took %d ms (total %d)", millis() - s1, millis() - s);
     doCloseFile = true;
     return true;
@@ -243,13 +491,16 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   } else { //file content is not valid JSON object
     f.seek(0, SeekSet);
     f.print('{'); //start JSON
+    if (indexedWrite) invalidatePresetIndex();
   }
 
   f.print(key);
+  if (indexedWrite) presetIndexSet(atoi(key +1), f.position(), contentLen);
 
   //Append object
   serializeJson(*content, f);
   f.write('}');
+  if (indexedWrite) presetIndexFileSize = f.size();
 
   doCloseFile = true;
   DEBUGFS_PRINTF("Appended, took %d ms (total %d)", millis() - s1, millis() - s);
@@ -273,14 +524,42 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   #endif
 
   uint32_t pos = 0;
-  f = WLED_FS.open(file, "r+");
-  if (!f && !WLED_FS.exists(file)) f = WLED_FS.open(file, "w+");
-  if (!f) {
-    DEBUGFS_PRINTLN(F("Failed to open!"));
-    return false;
+  if (doCloseFile && f && strcmp(atomicTarget, file) == 0) {
+    DEBUGFS_PRINTLN(F("Reuse open copy")); //consecutive writes to the same file are applied to the same copy
+  } else {
+    if (doCloseFile) closeFile(); //finish previous write first
+
+    //edit a copy of the file, it replaces the original in closeFile()
+    char tmp[33];
+    getTempFileName(tmp, file);
+    if (WLED_FS.exists(file)) {
+      File src = WLED_FS.open(file, "r");
+      size_t size = src ? src.size() : 0;
+      src.close();
+      updateFSInfo();
+      if (size + FS_BUFSIZE > fsBytesTotal - fsBytesUsed) { //not enough room for the copy
+        DEBUGFS_PRINTLN(F("No space for copy"));
+        errorFlag = ERR_FS_QUOTA;
+        return false;
+      }
+      if (copyFile(file, tmp)) f = WLED_FS.open(tmp, "r+");
+    } else {
+      f = WLED_FS.open(tmp, "w+");
+    }
+    if (!f) {
+      DEBUGFS_PRINTLN(F("Failed to open!"));
+      WLED_FS.remove(tmp);
+      errorFlag = ERR_FS_GENERAL;
+      return false;
+    }
+    strlcpy(atomicTarget, file, sizeof(atomicTarget));
   }
   
-  if (!bufferedFind(key)) //key does not exist in file
+  indexedWrite = isIndexedFile(file);
+  if (indexedWrite) presetFileLastWrite = millis();
+  uint32_t objLen = 0;
+  bool found = indexedWrite ? indexedFind(key, &objLen) : bufferedFind(key);
+  if (!found) //key does not exist in file
   {
     return appendObjectToFile(key, content, s);
   } 
@@ -288,7 +567,8 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   //an object with this key already exists, replace or delete it
   pos = f.position();
   //measure out end of old object
-  bufferedFindObjectEnd();
+  if (objLen) f.seek(pos + objLen);
+  else bufferedFindObjectEnd();
   uint32_t pos2 = f.position();
 
   uint32_t oldLen = pos2 - pos;
@@ -307,17 +587,28 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
     DEBUGFS_PRINTLN(F("replace"));
     f.seek(pos);
     serializeJson(*content, f);
+    if (indexedWrite) {
+      presetIndexSet(atoi(key +1), pos, contentLen);
+      presetFileSpace += pos2 - f.position();
+    }
     writeSpace(pos2 - f.position());
   } else if (contentLen && bufferedFindSpace(contentLen - oldLen, false)) { //enough leading spaces to replace
     DEBUGFS_PRINTLN(F("replace (trailing)"));
     f.seek(pos);
     serializeJson(*content, f);
+    if (indexedWrite) {
+      presetIndexSet(atoi(key +1), pos, contentLen);
+      presetIndexFileSize = f.size();
+      presetFileSpace -= min(presetFileSpace, contentLen - oldLen);
+    }
   } else {
     DEBUGFS_PRINTLN(F("delete"));
+    if (indexedWrite) presetIndexRemove(atoi(key +1));
     pos -= strlen(key);
     if (pos > 3) pos--; //also delete leading comma if not first object
     f.seek(pos);
     writeSpace(pos2 - pos);
+    if (indexedWrite) presetFileSpace += pos2 - pos;
     if (contentLen) return appendObjectToFile(key, content, s, contentLen);
   }
 
@@ -326,15 +617,15 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   return true;
 }
 
-bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest)
+bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest, const JsonDocument* filter)
 {
   char objKey[10];
   sprintf(objKey, "\"%d\":", id);
-  return readObjectFromFile(file, objKey, dest);
+  return readObjectFromFile(file, objKey, dest, filter);
 }
 
-//if the key is a nullptr, deserialize entire object
-bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
+//if the key is a nullptr, deserialize entire object. If filter is set, only the keys in it are deserialized
+bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest, const JsonDocument* filter)
 {
   if (doCloseFile) closeFile();
   #ifdef WLED_DEBUG_FS
@@ -344,7 +635,8 @@ bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
   f = WLED_FS.open(file, "r");
   if (!f) return false;
 
-  if (key != nullptr && !bufferedFind(key)) //key does not exist in file
+  uint32_t objLen = 0;
+  if (key != nullptr && !(isIndexedFile(file) ? indexedFind(key, &objLen) : bufferedFind(key))) //key does not exist in file
   {
     f.close();
     dest->clear();
@@ -352,13 +644,103 @@ bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
     return false;
   }
 
-  deserializeJson(*dest, f);
+  if (filter) deserializeJson(*dest, f, DeserializationOption::Filter(*filter));
+  else deserializeJson(*dest, f);
 
   f.close();
   DEBUGFS_PRINTF("Read, took %d ms\n", millis() - s);
   return true;
 }
 
+//percentage of presets.json taken up by whitespace left over from deleted or shrunk presets
+byte getPresetFileFragmentation() {
+  if (!presetIndexValid || !presetIndexFileSize) return 0;
+  return min(presetFileSpace, presetIndexFileSize) * 100 / presetIndexFileSize;
+}
+
+//rewrites presets.json without the whitespace between objects. The compacted copy is written to a
+//temporary file and only replaces the original once it is complete, so an interruption leaves the original intact
+bool compactPresetFile() {
+  #ifdef WLED_DEBUG_FS
+    DEBUGFS_PRINTLN(F("Compact presets"));
+    uint32_t s = millis();
+  #endif
+  if (doCloseFile) closeFile();
+
+  File src = WLED_FS.open("/presets.json", "r");
+  if (!src) return false;
+  char tmp[33];
+  getTempFileName(tmp, "/presets.json");
+  updateFSInfo();
+  if (src.size() + FS_BUFSIZE > fsBytesTotal - fsBytesUsed) { //not enough room for the copy
+    src.close();
+    return false;
+  }
+  File dst = WLED_FS.open(tmp, "w");
+  if (!dst) {
+    src.close();
+    return false;
+  }
+
+  byte in[FS_BUFSIZE], out[FS_BUFSIZE];
+  uint16_t bufsize = 0, outLen = 0, depth = 0;
+  bool inStr = false, esc = false, pendingComma = false, success = true;
+  byte last = 0;
+
+  while (success && (bufsize = src.read(in, FS_BUFSIZE)) > 0) {
+    for (uint16_t i = 0; i < bufsize && success; i++) {
+      byte c = in[i];
+      if (inStr) {
+        if (esc) esc = false;
+        else if (c == '\\') esc = true;
+        else if (c == '"') inStr = false;
+      } else {
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+        //commas between root objects are re-inserted only where needed, in case a deletion left a stray one
+        if (depth == 1 && c == ',') { pendingComma = true; continue; }
+        if (pendingComma && c != '}' && last != '{') out[outLen++] = ',';
+        pendingComma = false;
+        if (outLen >= FS_BUFSIZE -1) { success = (dst.write(out, outLen) == outLen); outLen = 0; }
+        if (c == '"') inStr = true;
+        else if (c == '{') depth++;
+        else if (c == '}' && depth) depth--;
+      }
+      out[outLen++] = c;
+      last = c;
+      if (outLen >= FS_BUFSIZE -1) { success = (dst.write(out, outLen) == outLen); outLen = 0; }
+    }
+  }
+  if (outLen) success = success && (dst.write(out, outLen) == outLen);
+  success = success && depth == 0 && !inStr && dst.size() > 2;
+  dst.close();
+  src.close();
+
+  if (success) success = replaceFile(tmp, "/presets.json");
+  else WLED_FS.remove(tmp);
+
+  //offsets have changed, index again
+  invalidatePresetIndex();
+  knownLargestSpace = UINT16_MAX;
+  f = WLED_FS.open("/presets.json", "r");
+  if (f) {
+    buildPresetIndex();
+    f.close();
+  }
+  updateFSInfo();
+  DEBUGFS_PRINTF("Compacted: %d, took %d ms\n", success, millis() - s);
+  return success;
+}
+
+//compacts presets.json once fragmentation is high and there were no preset changes for a while
+void handlePresetCompaction() {
+  static uint32_t lastAttempt = 0;
+  if (doCloseFile || presetFileSpace < PRESET_COMPACT_MIN_SPACE) return;
+  if (getPresetFileFragmentation() < PRESET_COMPACT_THRESHOLD) return;
+  if (millis() - presetFileLastWrite < PRESET_COMPACT_IDLE || millis() - lastAttempt < PRESET_COMPACT_IDLE) return;
+  lastAttempt = millis();
+  compactPresetFile();
+}
+
 void updateFSInfo() {
   #ifdef ARDUINO_ARCH_ESP32
     #if WLED_FS == LITTLEFS
@@ -405,6 +787,7 @@ bool handleFileRead(AsyncWebServerRequest* request, String path){
     request->send(WLED_FS, pathWithGz, contentType);
     return true;
   }*/
+  if (path.equals(F("/presets.json"))) flushPresetWrites(); //serve presets including unsaved changes
   if(WLED_FS.exists(path)) {
     request->send(WLED_FS, path, contentType);
     return true;
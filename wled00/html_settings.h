@@ -118,11 +118,13 @@ type="checkbox" name="PC"><br><br>Use Gamma correction for color: <input
 type="checkbox" name="GC"> (strongly recommended)<br>
 Use Gamma correction for brightness: <input type="checkbox" name="GB">
  (not recommended)<br><br>Brightness factor: <input name="BF" type="number" 
-min="1" max="255" required> %<h3>Transitions</h3>Crossfade: <input 
-type="checkbox" name="TF"><br>Transition Time: <input name="TD" maxlength="5" 
-size="2"> ms<br>Enable Palette transitions: <input type="checkbox" name="PF">
-<h3>Timed light</h3>Default Duration: <input name="TL" type="number" min="1" 
-max="255" required> min<br>Default Target brightness: <input name="TB" 
+min="1" max="255" required> %<br>Target frame rate: <input name="FR" 
+type="number" min="1" max="250" required> FPS<h3>Transitions</h3>Crossfade: 
+<input type="checkbox" name="TF"><br>Transition Time: <input name="TD" 
+maxlength="5" size="2"> ms<br>Enable Palette transitions: <input 
+type="checkbox" name="PF"><br>Enable Effect transitions: <input type="checkbox" 
+name="EF"><h3>Timed light</h3>Default Duration: <input name="TL" type="number" 
+min="1" max="255" required> min<br>Default Target brightness: <input name="TB" 
 type="number" min="0" max="255" required><br>Mode: <select name="TW"><option 
 value="0">Wait and set</option><option value="1">Fade</option><option value="2">
 Fade Color</option><option value="3">Sunrise</option></select><h3>Advanced</h3>
@@ -229,8 +231,9 @@ Send notifications on button press or IR: <input type="checkbox" name="SB"><br>
 Send Alexa notifications: <input type="checkbox" name="SA"><br>
 Send Philips Hue change notifications: <input type="checkbox" name="SH"><br>
 Send Macro notifications: <input type="checkbox" name="SM"><br>
-Send notifications twice: <input type="checkbox" name="S2"><br><i>
-Reboot required to apply changes.</i><h3>Realtime</h3>Receive UDP realtime: 
+Send notifications twice: <input type="checkbox" name="S2"><br>
+Render effects in step with synced nodes: <input type="checkbox" name="DE"><br>
+<i>Reboot required to apply changes.</i><h3>Realtime</h3>Receive UDP realtime: 
 <input type="checkbox" name="RD"><br><br><i>Network DMX input</i><br>Type: 
 <select name="DI" onchange="SP(),adj()"><option value="5568">E1.31 (sACN)
 </option><option value="6454">Art-Net</option><option value="4048">DDP</option>
@@ -270,7 +273,9 @@ Never use the MQTT password for another service!</b><br>Username: <input
 name="MQUSER" maxlength="40"><br>Password: <input type="password" name="MQPASS" 
 maxlength="40"><br>Client ID: <input name="MQCID" maxlength="40"><br>
 Device Topic: <input name="MD" maxlength="32"><br>Group Topic: <input name="MG" 
-maxlength="32"><br><i>Reboot required to apply changes. </i><a 
+maxlength="32"><br>Publish performance counters every <input name="MQPERF" 
+type="number" min="0" max="3600" class="d5"> s (0 = off)<br><i>
+Reboot required to apply changes. </i><a 
 href="https://github.com/Aircoookie/WLED/wiki/MQTT" target="_blank">MQTT info
 </a><h3>Philips Hue</h3><i>
 You can find the bridge IP and the light number in the 'About' section of the hue app.
@@ -380,7 +380,7 @@ void decodeIR44(uint32_t code)
     case IR44_COLDWHITE2  : {
       if (useRGBW) {        colorFromUint32(COLOR2_COLDWHITE2);   effectCurrent = 0; }    
       else                  colorFromUint24(COLOR_COLDWHITE2);                       }  break;
-    case IR44_REDPLUS     : relativeChange(&effectCurrent,  1, 0, MODE_COUNT);          break;
+    case IR44_REDPLUS     : relativeChange(&effectCurrent,  1, 0, strip.getModeCount());          break;
     case IR44_REDMINUS    : relativeChange(&effectCurrent, -1, 0);                      break;
     case IR44_GREENPLUS   : relativeChange(&effectPalette,  1, 0, strip.getPaletteCount() -1);     break;
     case IR44_GREENMINUS  : relativeChange(&effectPalette, -1, 0);                      break;
@@ -439,7 +439,7 @@ void decodeIR6(uint32_t code)
     case IR6_POWER: toggleOnOff();                                          break;
     case IR6_CHANNEL_UP: changeBrightness(10);                              break;
     case IR6_CHANNEL_DOWN: changeBrightness(-10);                           break;
-    case IR6_VOLUME_UP:   relativeChange(&effectCurrent, 1, 0, MODE_COUNT); break;  // next effect
+    case IR6_VOLUME_UP:   relativeChange(&effectCurrent, 1, 0, strip.getModeCount()); break;  // next effect
     case IR6_VOLUME_DOWN:                                                           // next palette
       relativeChange(&effectPalette, 1, 0, strip.getPaletteCount() -1); 
       switch(lastIR6ColourIdx) {
@@ -478,7 +478,7 @@ void decodeIR9(uint32_t code)
     //case IR9_DOWN       : changeEffectIntensity(-16);     break;
     case IR9_LEFT       : changeEffectSpeed(-16);                                     break;
     case IR9_RIGHT      : changeEffectSpeed(16);                                      break;
-    case IR9_SELECT     : relativeChange(&effectCurrent, 1, 0, MODE_COUNT);           break;
+    case IR9_SELECT     : relativeChange(&effectCurrent, 1, 0, strip.getModeCount());           break;
     default: return;
   }
   lastValidCode = code;
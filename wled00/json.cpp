@@ -4,6 +4,65 @@
  * JSON API (De)serialization
  */
 
+DynamicJsonDocument* jsonPoolDoc = nullptr;
+volatile bool jsonPoolLocked = false;
+#ifdef ARDUINO_ARCH_ESP32
+portMUX_TYPE jsonPoolMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+//returns true if the shared JSON buffer was free and is now owned by the caller
+bool lockJsonPool()
+{
+  bool success = false;
+  #ifdef ARDUINO_ARCH_ESP32
+  portENTER_CRITICAL(&jsonPoolMux);
+  #endif
+  if (!jsonPoolLocked) {
+    jsonPoolLocked = true;
+    success = true;
+  }
+  #ifdef ARDUINO_ARCH_ESP32
+  portEXIT_CRITICAL(&jsonPoolMux);
+  #endif
+  return success;
+}
+
+PooledJsonDoc::PooledJsonDoc(size_t capacity)
+{
+  _pooled = false;
+  if (capacity > JSON_SMALL_DOC_SIZE) {
+    if (lockJsonPool()) {
+      if (!jsonPoolDoc) jsonPoolDoc = new DynamicJsonDocument(JSON_BUFFER_SIZE);
+      _pooled = true;
+      _doc = jsonPoolDoc;
+      return;
+    }
+    jsonPoolBusyCount++;
+    DEBUG_PRINTLN(F("JSON buffer in use, allocating"));
+  }
+  _doc = new DynamicJsonDocument(capacity);
+}
+
+PooledJsonDoc::~PooledJsonDoc()
+{
+  size_t used = _doc->memoryUsage();
+  if (used > jsonPeakUsage) jsonPeakUsage = used;
+  if (_pooled) {
+    _doc->clear();
+    jsonPoolLocked = false;
+  } else {
+    delete _doc;
+  }
+}
+
+//capacity needed to deserialize len bytes of JSON. Worst case is an array of single digits,
+//which needs a variant slot for every 2 bytes of input, plus room for copied strings
+size_t jsonSizeForInput(size_t len)
+{
+  size_t capacity = JSON_OBJECT_SIZE(2) + len * (JSON_OBJECT_SIZE(1) / 2 + 1);
+  return (capacity > JSON_BUFFER_SIZE) ? JSON_BUFFER_SIZE : capacity;
+}
+
 void deserializeSegment(JsonObject elem, byte it)
 {
   byte id = elem[F("id")] | it;
@@ -89,6 +148,14 @@ void deserializeSegment(JsonObject elem, byte it)
     seg.setOption(SEG_OPTION_SELECTED, elem[F("sel")] | seg.getOption(SEG_OPTION_SELECTED));
     seg.setOption(SEG_OPTION_REVERSED, elem[F("rev")] | seg.getOption(SEG_OPTION_REVERSED));
     seg.setOption(SEG_OPTION_MIRROR  , elem[F("mi")]  | seg.getOption(SEG_OPTION_MIRROR  ));
+    seg.fps = elem[F("fps")] | seg.fps;
+    byte rs = elem[F("rs")] | seg.scale;
+    seg.scale = MIN(rs, MAX_RENDER_SCALE);
+    uint16_t w = elem["w"] | seg.width; //2D segment
+    seg.width = MIN(w, MAX_MATRIX_DIM);
+    bool serpentine = elem[F("srp")] | (bool)(seg.matrix & MATRIX_SERPENTINE);
+    byte rot = elem[F("rot")] | MATRIX_ROTATION(seg.matrix);
+    seg.matrix = (serpentine ? MATRIX_SERPENTINE : 0) | ((rot & 0x03) << 1);
 
     //temporary, strip object gets updated via colorUpdated()
     if (id == strip.getMainSegmentId()) {
@@ -153,6 +220,69 @@ void deserializeSegment(JsonObject elem, byte it)
   }
 }
 
+/*
+ * Binary pixel block, a compact alternative to the "i" array of deserializeSegment().
+ * Byte 0: segment id, byte 1: flags (bit 0 set: 4 bytes RGBW per pixel, else RGB),
+ * bytes 2-3: index of the first pixel within the segment (big endian), followed by raw pixel bytes.
+ */
+bool applyPixelBlock(byte id, uint16_t offset, const uint8_t* data, size_t len, bool rgbw)
+{
+  if (id >= strip.getMaxSegments()) return false;
+  WS2812FX::Segment& seg = strip.getSegment(id);
+  if (!seg.isActive()) return false;
+
+  strip.setPixelSegment(id);
+
+  //freeze and init to black
+  if (!seg.getOption(SEG_OPTION_FREEZE)) {
+    seg.setOption(SEG_OPTION_FREEZE, true);
+    strip.fill(0);
+  }
+
+  byte bpp = rgbw ? 4 : 3;
+  uint16_t segLen = seg.length();
+  for (size_t i = 0; i + bpp <= len && offset < segLen; i += bpp, offset++) {
+    strip.setPixelColor(offset, data[i], data[i+1], data[i+2], rgbw ? data[i+3] : 0);
+  }
+  strip.setPixelSegment(255);
+  strip.trigger();
+  return true;
+}
+
+bool handlePixelBlock(const uint8_t* payload, size_t len)
+{
+  if (len < PIXEL_BLOCK_HEADER_SIZE) return false;
+  uint16_t offset = (payload[2] << 8) | payload[3];
+  return applyPixelBlock(payload[0], offset, payload + PIXEL_BLOCK_HEADER_SIZE, len - PIXEL_BLOCK_HEADER_SIZE, payload[1] & PIXEL_BLOCK_FLAG_RGBW);
+}
+
+//called from network callbacks, the pixels are written with the next frame like every other state change
+bool postPixelBlock(const uint8_t* payload, size_t len)
+{
+  if (len < PIXEL_BLOCK_HEADER_SIZE || payload[0] >= strip.getMaxSegments() || !strip.getSegment(payload[0]).isActive()) return false;
+  if (postStateChange(STATE_CMD_PIXELS, (const char*)payload, len)) return true;
+  lockStrip();
+  bool success = handlePixelBlock(payload, len);
+  unlockStrip();
+  return success;
+}
+
+//queues pixels of a block that arrives in parts, with a header for the part
+bool postPixels(byte id, uint16_t offset, const uint8_t* data, size_t len, bool rgbw)
+{
+  if (!len) return true;
+  uint8_t* block = (uint8_t*)malloc(len + PIXEL_BLOCK_HEADER_SIZE);
+  if (!block) return false;
+  block[0] = id;
+  block[1] = rgbw ? PIXEL_BLOCK_FLAG_RGBW : 0;
+  block[2] = offset >> 8;
+  block[3] = offset & 0xFF;
+  memcpy(block + PIXEL_BLOCK_HEADER_SIZE, data, len);
+  bool success = postPixelBlock(block, len + PIXEL_BLOCK_HEADER_SIZE);
+  free(block);
+  return success;
+}
+
 bool deserializeState(JsonObject root)
 {
   strip.applyToAllSelected = false;
@@ -187,6 +317,7 @@ bool deserializeState(JsonObject root)
   presetCycleMax = ccnf[F("max")] | presetCycleMax;
   tr = ccnf[F("time")] | -1;
   if (tr >= 2) presetCycleTime = tr;
+  schedulePresetCycle();
 
   JsonObject nl = root["nl"];
   nightlightActive    = nl["on"]      | nightlightActive;
@@ -297,6 +428,11 @@ void serializeSegment(JsonObject& root, WS2812FX::Segment& seg, byte id, bool fo
 	if (!forPreset)  root[F("len")] = seg.stop - seg.start;
   root[F("grp")] = seg.grouping;
   root[F("spc")] = seg.spacing;
+  root[F("fps")] = seg.fps;
+  root[F("rs")] = (seg.scale > 1) ? seg.scale : 1;
+  root["w"] = seg.width;
+  root[F("srp")] = (bool)(seg.matrix & MATRIX_SERPENTINE);
+  root[F("rot")] = MATRIX_ROTATION(seg.matrix);
   root["on"] = seg.getOption(SEG_OPTION_ON);
   byte segbri = seg.opacity;
   root["bri"] = (segbri) ? segbri : 255;
@@ -472,6 +608,15 @@ void serializeInfo(JsonObject root)
   fs_info["u"] = fsBytesUsed / 1000;
   fs_info["t"] = fsBytesTotal / 1000;
   fs_info[F("pmt")] = presetsModifiedTime;
+  fs_info[F("pch")] = presetCacheHits;
+  fs_info[F("pcm")] = presetCacheMisses;
+  fs_info[F("frag")] = getPresetFileFragmentation();
+  fs_info[F("wa")] = fsWritesAvoided;
+
+  JsonObject json_info = root.createNestedObject("json");
+  json_info[F("peak")] = jsonPeakUsage;
+  json_info[F("size")] = JSON_BUFFER_SIZE;
+  json_info[F("busy")] = jsonPoolBusyCount;
   
   #ifdef ARDUINO_ARCH_ESP32
   #ifdef WLED_DEBUG
@@ -534,6 +679,19 @@ void serializeInfo(JsonObject root)
   root["mac"] = escapedMac;
 }
 
+//effect names as JSON array, from the effect table so that usermod effects are included
+void serializeModeNames(Print& dest)
+{
+  dest.print('[');
+  for (byte i = 0; i < strip.getModeCount(); i++) {
+    if (i) dest.print(',');
+    dest.print('"');
+    dest.print((const __FlashStringHelper*)strip.getModeName(i));
+    dest.print('"');
+  }
+  dest.print(']');
+}
+
 void serveJson(AsyncWebServerRequest* request)
 {
   byte subJson = 0;
@@ -541,12 +699,16 @@ void serveJson(AsyncWebServerRequest* request)
   if      (url.indexOf("state") > 0) subJson = 1;
   else if (url.indexOf("info")  > 0) subJson = 2;
   else if (url.indexOf("si") > 0) subJson = 3;
+  else if (url.indexOf(F("tasks")) > 0) subJson = 4;
+  else if (url.indexOf(F("perf")) > 0) subJson = 5;
   else if (url.indexOf("live")  > 0) {
     serveLiveLeds(request);
     return;
   }
   else if (url.indexOf(F("eff"))   > 0) {
-    request->send_P(200, "application/json", JSON_mode_names);
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    serializeModeNames(*response);
+    request->send(response);
     return;
   }
   else if (url.indexOf(F("pal"))   > 0) {
@@ -558,28 +720,43 @@ void serveJson(AsyncWebServerRequest* request)
     return;
   }
   
-  AsyncJsonResponse* response = new AsyncJsonResponse(JSON_BUFFER_SIZE);
-  JsonObject doc = response->getRoot();
+  //written to the response as it is serialized, so there is no second copy of the whole response
+  AsyncResponseStream* response = request->beginResponseStream("application/json");
+  { //scope JsonDocument so the shared buffer is released before sending
+    PooledJsonDoc jsonBuffer(JSON_BUFFER_SIZE);
+    JsonObject doc = jsonBuffer->to<JsonObject>();
 
-  switch (subJson)
-  {
-    case 1: //state
-      serializeState(doc); break;
-    case 2: //info
-      serializeInfo(doc); break;
-    default: //all
-      JsonObject state = doc.createNestedObject("state");
-      serializeState(state);
-      JsonObject info  = doc.createNestedObject("info");
-      serializeInfo(info);
-      if (subJson != 3)
-      {
-        doc[F("effects")]  = serialized((const __FlashStringHelper*)JSON_mode_names);
-        doc[F("palettes")] = serialized((const __FlashStringHelper*)JSON_palette_names);
-      }
+    switch (subJson)
+    {
+      case 1: //state
+        serializeState(doc); break;
+      case 2: //info
+        serializeInfo(doc); break;
+      case 4: //loop task timing
+        serializeTasks(doc); break;
+      case 5: //performance counters
+        serializePerf(doc); break;
+      default: //all
+        JsonObject state = doc.createNestedObject("state");
+        serializeState(state);
+        JsonObject info  = doc.createNestedObject("info");
+        serializeInfo(info);
+    }
+
+    if (subJson == 0) { //effect and palette names are streamed from flash instead of being copied into the document
+      response->print(F("{\"state\":"));
+      serializeJson(doc["state"], *response);
+      response->print(F(",\"info\":"));
+      serializeJson(doc["info"], *response);
+      response->print(F(",\"effects\":"));
+      serializeModeNames(*response);
+      response->print(F(",\"palettes\":"));
+      response->print((const __FlashStringHelper*)JSON_palette_names);
+      response->print('}');
+    } else {
+      serializeJson(*jsonBuffer, *response);
+    }
   }
-  
-  response->setLength();
   request->send(response);
 }
 
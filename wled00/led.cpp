@@ -295,8 +295,11 @@ void handleNightlight()
     }
     nightlightActiveOld = false;
   }
+}
 
-  //also handle preset cycle here
+//called by the scheduler when the next preset of the cycle is due
+void handlePresetCycle()
+{
   if (presetCyclingEnabled && (millis() - presetCycledTime > (100*presetCycleTime)))
   {
     presetCycledTime = millis();
@@ -310,6 +313,13 @@ void handleNightlight()
   }
 }
 
+//needs to be called whenever preset cycling is enabled or its timing changed
+void schedulePresetCycle()
+{
+  if (presetCyclingEnabled) scheduleEvent(EVENT_PRESET_CYCLE, presetCycledTime + 100*presetCycleTime +1);
+  else cancelEvent(EVENT_PRESET_CYCLE);
+}
+
 //utility for FastLED to use our custom timer
 uint32_t get_millisecond_timer()
 {
@@ -81,21 +81,25 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
 
   if (strcmp(topic, "/col") == 0)
   {
+    if (postStateChange(STATE_CMD_COLOR, payload, len)) return;
     colorFromDecOrHexString(col, (char*)payload);
     colorUpdated(NOTIFIER_CALL_MODE_DIRECT_CHANGE);
   } else if (strcmp(topic, "/api") == 0)
   {
     if (payload[0] == '{') { //JSON API
-      DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-      deserializeJson(doc, payload);
-      deserializeState(doc.as<JsonObject>());
+      if (postStateChange(STATE_CMD_JSON, payload, len)) return;
+      PooledJsonDoc doc(jsonSizeForInput(len));
+      deserializeJson(*doc, payload, len);
+      deserializeState(doc->as<JsonObject>());
     } else { //HTTP API
       String apireq = "win&";
       apireq += (char*)payload;
+      if (postStateChange(STATE_CMD_HTTP, apireq.c_str(), apireq.length())) return;
       handleSet(nullptr, apireq);
     }
   } else if (strcmp(topic, "") == 0)
   {
+    if (postStateChange(STATE_CMD_BRI, payload, len)) return;
     parseMQTTBriPayload(payload);
   }
 }
@@ -131,6 +135,26 @@ void publishMqtt()
   mqtt->publish(subuf, 0, true, apires);
 }
 
+//performance counters, see perf.cpp
+void publishPerf()
+{
+  if (!WLED_MQTT_CONNECTED) return;
+  char* payload;
+  { //scope JsonDocument so it releases its buffer
+    PooledJsonDoc doc(perfDocSize());
+    serializePerf(doc->to<JsonObject>());
+    size_t len = measureJson(*doc) +1;
+    payload = (char*)malloc(len);
+    if (!payload) return;
+    serializeJson(*doc, payload, len);
+  }
+  char subuf[38];
+  strcpy(subuf, mqttDeviceTopic);
+  strcat(subuf, "/perf");
+  mqtt->publish(subuf, 0, false, payload);
+  free(payload);
+}
+
 
 //HA autodiscovery was removed in favor of the native integration in HA v0.102.0
 
@@ -168,4 +192,5 @@ bool initMqtt()
 #else
 bool initMqtt(){return false;}
 void publishMqtt(){}
+void publishPerf(){}
 #endif
@@ -259,6 +259,13 @@ byte weekdayMondayFirst()
   return wd;
 }
 
+//schedules checkTimers() for the start of the next minute.
+//localTime has a resolution of seconds, so timers fire within the first second of their minute
+void scheduleTimers()
+{
+  scheduleEvent(EVENT_TIMERS, millis() + (60 - second(localTime)) * 1000);
+}
+
 void checkTimers()
 {
   if (lastTimerMinute != minute(localTime)) //only check once a new minute begins
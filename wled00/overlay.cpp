@@ -25,7 +25,6 @@ void handleOverlays()
   {
     initCronixie();
     updateLocalTime();
-    checkTimers();
     checkCountdown();
     if (overlayCurrent == 3) _overlayCronixie();//Diamex cronixie clock kit
     overlayRefreshedTime = millis();
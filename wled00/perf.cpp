@@ -0,0 +1,121 @@
+#include "wled.h"
+
+/*
+ * Performance counters, always available as /json/perf and optionally published to MQTT (<device topic>/perf)
+ * Loop and realtime figures are for the last full second, render timing is kept by WS2812FX.
+ */
+
+uint32_t perfLastLoop = 0;       //micros() at the start of the previous loop
+uint32_t perfWindowStart = 0;    //millis() at the start of the current second
+uint32_t perfLastPublish = 0;
+
+//current second
+uint16_t perfLoopCount = 0;
+uint32_t perfLoopSumUs = 0, perfLoopMinUs = UINT32_MAX, perfLoopMaxUs = 0;
+uint32_t perfFramesStart = 0, perfPacketsStart = 0, perfDropsStart = 0;
+
+//last full second
+uint16_t perfLoops = 0, perfFps = 0, perfPackets = 0, perfDrops = 0;
+uint32_t perfLoopAvg = 0, perfLoopMin = 0, perfLoopMax = 0;
+
+uint32_t perfSegmentFramesStart[MAX_NUM_SEGMENTS] = {0};
+uint16_t perfSegmentFps[MAX_NUM_SEGMENTS] = {0};
+
+uint32_t perfHeapMin = UINT32_MAX;
+
+//called once at the start of every loop
+void handlePerf()
+{
+  uint32_t nowUs = micros();
+  if (perfLastLoop) {
+    uint32_t period = nowUs - perfLastLoop;
+    perfLoopSumUs += period;
+    if (period < perfLoopMinUs) perfLoopMinUs = period;
+    if (period > perfLoopMaxUs) perfLoopMaxUs = period;
+    perfLoopCount++;
+  }
+  perfLastLoop = nowUs;
+
+  #ifndef ARDUINO_ARCH_ESP32
+  uint32_t heap = ESP.getFreeHeap();
+  if (heap < perfHeapMin) perfHeapMin = heap;
+  #endif
+
+  if (millis() - perfWindowStart < 1000) return;
+  perfWindowStart = millis();
+  perfLoops = perfLoopCount;
+  perfLoopAvg = perfLoopCount ? perfLoopSumUs / perfLoopCount : 0;
+  perfLoopMin = perfLoopCount ? perfLoopMinUs : 0;
+  perfLoopMax = perfLoopMaxUs;
+  perfFps = strip.perfFrames - perfFramesStart;
+  perfPackets = realtimePackets - perfPacketsStart;
+  perfDrops = realtimeDrops - perfDropsStart;
+  perfLoopCount = 0; perfLoopSumUs = 0; perfLoopMinUs = UINT32_MAX; perfLoopMaxUs = 0;
+  perfFramesStart = strip.perfFrames; perfPacketsStart = realtimePackets; perfDropsStart = realtimeDrops;
+  for (byte i = 0; i < MAX_NUM_SEGMENTS; i++) {
+    perfSegmentFps[i] = strip.perfSegmentFrames[i] - perfSegmentFramesStart[i];
+    perfSegmentFramesStart[i] = strip.perfSegmentFrames[i];
+  }
+
+  if (perfMqttInterval && millis() - perfLastPublish >= perfMqttInterval * 1000UL) {
+    perfLastPublish = millis();
+    publishPerf();
+  }
+}
+
+//document capacity for serializePerf(), grows with the number of active segments
+size_t perfDocSize()
+{
+  byte segs = 0;
+  for (byte i = 0; i < strip.getMaxSegments(); i++) {
+    if (strip.getSegment(i).isActive()) segs++;
+  }
+  return JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(segs) + segs * (JSON_OBJECT_SIZE(3) + 4)
+       + 2 * JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(3) + 256; //256 for the copied keys
+}
+
+void serializePerf(JsonObject root)
+{
+  JsonObject loop = root.createNestedObject(F("loop"));
+  loop[F("lps")] = perfLoops;
+  loop[F("avg")] = perfLoopAvg;  //loop period in us
+  loop[F("min")] = perfLoopMin;
+  loop[F("max")] = perfLoopMax;
+  loop[F("jit")] = perfLoopMax - perfLoopMin;
+
+  JsonObject fx = root.createNestedObject("fx");
+  fx[F("fps")] = perfFps;
+  fx[F("abl")] = strip.perfAblUs;
+  fx[F("show")] = strip.perfShowUs;
+  fx[F("tgt")] = strip.getTargetFps();
+  JsonArray segs = fx.createNestedArray("seg"); //effect time and achieved frame rate per active segment
+  for (byte i = 0; i < strip.getMaxSegments(); i++) {
+    if (!strip.getSegment(i).isActive()) continue;
+    JsonObject seg = segs.createNestedObject();
+    seg["id"] = i;
+    seg["us"] = strip.perfEffectUs[i];
+    seg[F("fps")] = perfSegmentFps[i];
+  }
+
+  JsonObject fxData = fx.createNestedObject(F("data")); //segment data arena
+  fxData[F("used")] = strip.getSegmentDataUsed();
+  fxData[F("size")] = MAX_SEGMENT_DATA;
+  fxData[F("block")] = strip.getSegmentDataFreeBlock();
+  fxData[F("comp")] = strip.getSegmentDataCompactions();
+
+  JsonObject rt = root.createNestedObject("rt");
+  rt[F("pps")] = perfPackets;
+  rt[F("drop")] = perfDrops;
+  rt[F("total")] = realtimePackets;
+  rt[F("dropped")] = realtimeDrops;
+
+  JsonObject heap = root.createNestedObject(F("heap"));
+  heap[F("free")] = ESP.getFreeHeap();
+  #ifdef ARDUINO_ARCH_ESP32
+  heap[F("min")] = ESP.getMinFreeHeap();
+  heap[F("block")] = ESP.getMaxAllocHeap();
+  #else
+  heap[F("min")] = perfHeapMin;
+  heap[F("block")] = ESP.getMaxFreeBlockSize();
+  #endif
+}
@@ -2,39 +2,76 @@
 
 /*
  * Handles playlists, timed sequences of presets
+ *
+ * A playlist is compiled once when it is loaded into a flat array of entries. Presets that contain a playlist
+ * themselves are resolved into their entries at that time (up to PLAYLIST_MAX_DEPTH levels), so playback never
+ * needs to parse JSON other than the preset being applied. The preset of the next entry is prefetched into the
+ * preset cache PLAYLIST_PREFETCH ms before it is due.
  */
 
 typedef struct PlaylistEntry {
   uint8_t preset;
-  uint16_t dur;
-  uint16_t tr;
+  uint8_t depth;    //nesting level the entry was resolved from, 0 = top level playlist
+  uint16_t dur;     //duration in tenths of seconds
+  uint16_t tr;      //transition in tenths of seconds
 } ple;
 
 byte playlistRepeat = 1;
 byte playlistEndPreset = 0;
+bool playlistShuffle = false;
+bool playlistPrefetched = false;
 
-uint8_t* playlistEntries;
+PlaylistEntry* playlistEntries = nullptr;
 
-byte playlistLen;
-int8_t playlistIndex = -1;
+uint16_t playlistLen = 0;
+uint16_t playlistAlloc = 0; //number of entries allocated
+int16_t playlistIndex = -1;
 
 uint16_t playlistEntryDur = 0;
 
-void loadPlaylist(JsonObject playlistObj) {
-  delete playlistEntries;
-  playlistIndex = -1; playlistEntryDur = 0;
+void unloadPlaylist() {
+  free(playlistEntries);
+  playlistEntries = nullptr;
+  playlistLen = 0;
+  playlistAlloc = 0;
+  playlistIndex = -1;
+  playlistEntryDur = 0;
+}
+
+//makes room for count entries at position pos, returns false if out of memory or PLAYLIST_MAX_ENTRIES would be exceeded
+bool insertPlaylistEntries(uint16_t pos, uint16_t count) {
+  if (playlistLen + count > PLAYLIST_MAX_ENTRIES) return false;
+  if (playlistLen + count > playlistAlloc) {
+    uint16_t newAlloc = playlistLen + count + 8;
+    if (newAlloc > PLAYLIST_MAX_ENTRIES) newAlloc = PLAYLIST_MAX_ENTRIES;
+    PlaylistEntry* grown = (PlaylistEntry*)realloc(playlistEntries, newAlloc * sizeof(ple));
+    if (!grown) return false;
+    playlistEntries = grown;
+    playlistAlloc = newAlloc;
+  }
+  memmove(&playlistEntries[pos + count], &playlistEntries[pos], (playlistLen - pos) * sizeof(ple));
+  playlistLen += count;
+  return true;
+}
+
+//compiles the entries of a playlist JSON object into the entry array at position pos, returns the number of entries added.
+//Entries that do not fit within PLAYLIST_MAX_ENTRIES are left out
+uint16_t compilePlaylist(JsonObject playlistObj, uint16_t pos, uint8_t depth) {
   JsonArray presets = playlistObj["ps"];
-  playlistLen = presets.size();
-  if (playlistLen == 0) return;
-  if (playlistLen > 100) playlistLen = 100;
-  uint16_t dataSize = sizeof(ple) * playlistLen;
-  playlistEntries = new byte[dataSize];
-  PlaylistEntry* entries = reinterpret_cast<PlaylistEntry*>(playlistEntries);
-
-  byte it = 0;
+  uint16_t len = presets.size();
+  if (len > PLAYLIST_MAX_ENTRIES - playlistLen) {
+    len = PLAYLIST_MAX_ENTRIES - playlistLen;
+    DEBUG_PRINT(F("Playlist cut short at depth "));
+    DEBUG_PRINTLN(depth);
+  }
+  if (len == 0 || !insertPlaylistEntries(pos, len)) return 0;
+  PlaylistEntry* entries = &playlistEntries[pos];
+
+  uint16_t it = 0;
   for (int ps : presets) {
-    if (it >= playlistLen) break;
+    if (it >= len) break;
     entries[it].preset = ps;
+    entries[it].depth = depth;
     it++;
   }
 
@@ -45,12 +82,12 @@ void loadPlaylist(JsonObject playlistObj) {
     it = 1;
   } else {
     for (int dur : durations) {
-      if (it >= playlistLen) break;
+      if (it >= len) break;
       entries[it].dur = dur;
       it++;
     }
   }
-  for (int i = it; i < playlistLen; i++) entries[i].dur = entries[it -1].dur;
+  for (uint16_t i = it; i < len; i++) entries[i].dur = entries[it -1].dur;
 
   it = 0;
   JsonArray tr = playlistObj["transition"];
@@ -59,26 +96,125 @@ void loadPlaylist(JsonObject playlistObj) {
     it = 1;
   } else {
     for (int transition : tr) {
-      if (it >= playlistLen) break;
+      if (it >= len) break;
       entries[it].tr = transition;
       it++;
     }
   }
-  for (int i = it; i < playlistLen; i++) entries[i].tr = entries[it -1].tr;
+  for (uint16_t i = it; i < len; i++) entries[i].tr = entries[it -1].tr;
+
+  return len;
+}
+
+//replaces entries whose preset is a playlist itself by the entries of that playlist.
+//doc is overwritten, only the "playlist" object of each preset is read into it
+void resolveNestedPlaylists(JsonDocument* doc) {
+  byte checked[32] = {0}; //bit set if it is known whether the preset is a playlist
+  byte nested[32] = {0};  //bit set if the preset contains a playlist
+  StaticJsonDocument<32> filter;
+  filter[F("playlist")] = true;
+  flushPresetWrites(); //presets are read from the file directly
+
+  uint16_t i = 0;
+  while (i < playlistLen) {
+    byte ps = playlistEntries[i].preset;
+    bool loaded = false;
+    if (!(checked[ps >> 3] & (1 << (ps & 7)))) {
+      checked[ps >> 3] |= 1 << (ps & 7);
+      loaded = readObjectFromFileUsingId("/presets.json", ps, doc, &filter);
+      if (loaded && doc->containsKey(F("playlist"))) nested[ps >> 3] |= 1 << (ps & 7);
+    }
+    if (!(nested[ps >> 3] & (1 << (ps & 7)))) { i++; continue; }
+
+    //replace the entry by the entries of the nested playlist, these are checked in the next iterations.
+    //Playlists nested too deeply (e.g. containing themselves) are left out
+    uint8_t depth = playlistEntries[i].depth +1;
+    if (depth <= PLAYLIST_MAX_DEPTH && (loaded || readObjectFromFileUsingId("/presets.json", ps, doc, &filter))) {
+      compilePlaylist((*doc)[F("playlist")].as<JsonObject>(), i +1, depth);
+    } else {
+      DEBUG_PRINTLN(F("Playlist nesting too deep"));
+    }
+    memmove(&playlistEntries[i], &playlistEntries[i +1], (playlistLen - i -1) * sizeof(ple));
+    playlistLen--;
+  }
+}
+
+void shufflePlaylist() {
+  for (uint16_t i = playlistLen -1; i > 0; i--) {
+    uint16_t j = random16(i +1);
+    PlaylistEntry tmp = playlistEntries[i];
+    playlistEntries[i] = playlistEntries[j];
+    playlistEntries[j] = tmp;
+  }
+}
 
+void loadPlaylist(JsonObject playlistObj) {
+  unloadPlaylist();
+  if (compilePlaylist(playlistObj, 0, 0) == 0) return;
   playlistRepeat = playlistObj[F("repeat")] | 0;
   playlistEndPreset = playlistObj[F("end")] | 0;
+  playlistShuffle = playlistObj["r"] | false;
+
+  //playlistObj is not used from here on, the document it is in (fileDoc) is reused to read nested playlists
+  if (fileDoc) {
+    resolveNestedPlaylists(fileDoc);
+  } else {
+    PooledJsonDoc doc(JSON_BUFFER_SIZE);
+    resolveNestedPlaylists(doc.get());
+  }
+  if (playlistLen == 0) {
+    unloadPlaylist();
+    return;
+  }
+  DEBUG_PRINT(F("Playlist entries: "));
+  DEBUG_PRINTLN(playlistLen);
+
+  if (playlistShuffle) shufflePlaylist();
+  playlistPrefetched = false;
 
   currentPlaylist = 0; //TODO here we need the preset ID where the playlist is saved
+  schedulePlaylist();
+}
+
+//schedules the next call of handlePlaylist(), at the prefetch time or the time the next entry is due
+void schedulePlaylist()
+{
+  if (currentPlaylist < 0 || playlistEntries == nullptr) return;
+  if (presetCyclingEnabled) { //playlist paused, check again later
+    scheduleEvent(EVENT_PLAYLIST, millis() + SCHEDULER_PAUSE_RETRY);
+    return;
+  }
+  uint32_t dur = 100*playlistEntryDur;
+  if (!playlistPrefetched) dur = (dur > PLAYLIST_PREFETCH) ? dur - PLAYLIST_PREFETCH : 0;
+  scheduleEvent(EVENT_PLAYLIST, presetCycledTime + dur +1);
 }
 
 void handlePlaylist()
 {
   if (currentPlaylist < 0 || playlistEntries == nullptr || presetCyclingEnabled) return;
-  
-  if (millis() - presetCycledTime > (100*playlistEntryDur))
+
+  uint32_t elapsed = millis() - presetCycledTime;
+  uint32_t dur = 100*playlistEntryDur;
+
+  //load the next preset into RAM ahead of time so the switch is not delayed by reading flash
+  if (!playlistPrefetched && elapsed + PLAYLIST_PREFETCH > dur) {
+    playlistPrefetched = true;
+    if (playlistIndex +1 < playlistLen) {
+      prefetchPreset(playlistEntries[playlistIndex +1].preset);
+    } else if (playlistRepeat == 1) {
+      prefetchPreset(playlistEndPreset);
+    } else {
+      if (playlistShuffle) shufflePlaylist(); //new order for the next round
+      prefetchPreset(playlistEntries[0].preset);
+    }
+  }
+
+  if (elapsed > dur)
   {
-    presetCycledTime = millis();
+    //keep to the schedule unless the switch is already late by more than an entry (e.g. after a pause)
+    if (playlistIndex >= 0 && elapsed < 2*dur) presetCycledTime += dur;
+    else presetCycledTime = millis();
+    playlistPrefetched = false;
     if (bri == 0 || nightlightActive) return;
 
     playlistIndex++;
@@ -86,21 +222,18 @@ void handlePlaylist()
       playlistIndex = 0;
       if (playlistRepeat == 1) { //stop
         currentPlaylist = -1;
-        delete playlistEntries;
-        playlistEntries = nullptr;
+        unloadPlaylist();
         if (playlistEndPreset) applyPreset(playlistEndPreset);
         return;
       }
       if (playlistRepeat > 1) playlistRepeat--;
     }
 
-    PlaylistEntry* entries = reinterpret_cast<PlaylistEntry*>(playlistEntries);
-
     jsonTransitionOnce = true;
-    transitionDelayTemp = entries[playlistIndex].tr * 100;
+    transitionDelayTemp = playlistEntries[playlistIndex].tr * 100;
 
-    applyPreset(entries[playlistIndex].preset);
-    playlistEntryDur = entries[playlistIndex].dur;
+    playlistEntryDur = playlistEntries[playlistIndex].dur;
     if (playlistEntryDur == 0) playlistEntryDur = 10;
+    applyPreset(playlistEntries[playlistIndex].preset);
   }
-}
\ No newline at end of file
+}
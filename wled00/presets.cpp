@@ -4,11 +4,220 @@
  * Methods to handle saving and loading presets to/from the filesystem
  */
 
+/*
+ * LRU cache of serialized presets, so presets that are recalled repeatedly (e.g. by a playlist)
+ * are deserialized from RAM instead of being read from flash every time
+ */
+struct PresetCacheEntry {
+  char* json;
+  uint16_t len;
+  byte index;         //0 = slot unused
+  uint32_t lastUsed;
+};
+
+PresetCacheEntry presetCache[PRESET_CACHE_SIZE];
+uint32_t presetCacheTick = 0;
+uint16_t presetCacheBytes = 0;
+
+PresetCacheEntry* presetCacheFind(byte index)
+{
+  for (byte i = 0; i < PRESET_CACHE_SIZE; i++) {
+    if (presetCache[i].index == index) return &presetCache[i];
+  }
+  return nullptr;
+}
+
+void presetCacheFree(PresetCacheEntry* e)
+{
+  free(e->json);
+  presetCacheBytes -= e->len;
+  e->json = nullptr;
+  e->len = 0;
+  e->index = 0;
+}
+
+//removes a preset from the cache, needs to be called whenever it is changed or deleted
+void presetCacheRemove(byte index)
+{
+  PresetCacheEntry* e = presetCacheFind(index);
+  if (e) presetCacheFree(e);
+}
+
+//empties the cache, needed when presets.json was changed without savePreset() or deletePreset()
+void presetCacheClear()
+{
+  for (byte i = 0; i < PRESET_CACHE_SIZE; i++) {
+    if (presetCache[i].index) presetCacheFree(&presetCache[i]);
+  }
+}
+
+void presetCacheAdd(byte index, JsonDocument* doc)
+{
+  size_t len = measureJson(*doc);
+  if (len > PRESET_CACHE_MAX_BYTES / 2) return; //do not let a single large preset displace the whole cache
+
+  //evict least recently used presets until there is a free slot and enough room
+  PresetCacheEntry* slot = presetCacheFind(0);
+  while (!slot || presetCacheBytes + len > PRESET_CACHE_MAX_BYTES) {
+    PresetCacheEntry* lru = nullptr;
+    for (byte i = 0; i < PRESET_CACHE_SIZE; i++) {
+      if (presetCache[i].index && (!lru || presetCache[i].lastUsed < lru->lastUsed)) lru = &presetCache[i];
+    }
+    if (!lru) return;
+    presetCacheFree(lru);
+    slot = lru;
+  }
+
+  slot->json = (char*)malloc(len +1);
+  if (!slot->json) return;
+  serializeJson(*doc, slot->json, len +1);
+  slot->len = len;
+  slot->index = index;
+  slot->lastUsed = ++presetCacheTick;
+  presetCacheBytes += len;
+}
+
+/*
+ * Deferred preset writes. Saves and deletes are queued with one entry per preset, a newer change replaces a pending one.
+ * The queue is written to flash in one go once there were no changes for WRITE_COALESCE_IDLE ms
+ * (or at the latest WRITE_COALESCE_MAX ms after the first change), before presets.json is served and before a reboot.
+ */
+struct PendingPresetWrite {
+  char* json;         //nullptr = delete preset
+  uint16_t len;
+  byte index;         //0 = slot unused
+};
+
+PendingPresetWrite pendingPresetWrites[PENDING_PRESET_WRITES];
+uint32_t presetWriteLastChange = 0;
+uint32_t presetWriteFirstChange = 0;
+bool presetWritesPending = false;
+
+PendingPresetWrite* pendingPresetFind(byte index)
+{
+  for (byte i = 0; i < PENDING_PRESET_WRITES; i++) {
+    if (pendingPresetWrites[i].index == index) return &pendingPresetWrites[i];
+  }
+  return nullptr;
+}
+
+void clearPresetWrites()
+{
+  for (byte i = 0; i < PENDING_PRESET_WRITES; i++) {
+    free(pendingPresetWrites[i].json);
+    pendingPresetWrites[i].json = nullptr;
+    pendingPresetWrites[i].len = 0;
+    pendingPresetWrites[i].index = 0;
+  }
+  presetWritesPending = false;
+}
+
+void flushPresetWrites()
+{
+  if (!presetWritesPending) return;
+  if (presetFileReplaced()) { //uploaded via /edit, the queued changes would be merged into the new file
+    DEBUGFS_PRINTLN(F("Preset file changed, drop writes"));
+    presetCacheClear();
+    clearPresetWrites();
+    return;
+  }
+  DEBUGFS_PRINTLN(F("Flush preset writes"));
+  {
+    PooledJsonDoc doc(JSON_BUFFER_SIZE);
+    for (byte i = 0; i < PENDING_PRESET_WRITES; i++) {
+      PendingPresetWrite* p = &pendingPresetWrites[i];
+      if (!p->index) continue;
+      doc->clear();
+      if (p->json) deserializeJson(*doc, (const char*)p->json, p->len);
+      writeObjectToFileUsingId("/presets.json", p->index, doc.get()); //consecutive writes share one copy of the file
+    }
+  }
+  clearPresetWrites();
+  if (doCloseFile) closeFile();
+  updateFSInfo();
+}
+
+//queues saving doc as preset index, or deleting the preset if doc is nullptr
+void queuePresetWrite(byte index, JsonDocument* doc)
+{
+  PendingPresetWrite* p = pendingPresetFind(index);
+  if (p) {
+    fsWritesAvoided++; //the previous change of this preset is never written
+    free(p->json);
+  } else {
+    p = pendingPresetFind(0);
+    if (!p) {
+      flushPresetWrites();
+      p = &pendingPresetWrites[0];
+    }
+  }
+  p->json = nullptr;
+  p->len = 0;
+  p->index = index;
+
+  if (doc && !doc->isNull()) {
+    size_t len = measureJson(*doc);
+    p->json = (char*)malloc(len +1);
+    if (!p->json) { //out of memory, write immediately
+      p->index = 0;
+      writeObjectToFileUsingId("/presets.json", index, doc);
+      updateFSInfo();
+      return;
+    }
+    serializeJson(*doc, p->json, len +1);
+    p->len = len;
+  }
+
+  presetWriteLastChange = millis();
+  if (!presetWritesPending) presetWriteFirstChange = presetWriteLastChange;
+  presetWritesPending = true;
+}
+
+void handlePresetWrites()
+{
+  if (!presetWritesPending) return;
+  if (millis() - presetWriteLastChange < WRITE_COALESCE_IDLE && millis() - presetWriteFirstChange < WRITE_COALESCE_MAX) return;
+  flushPresetWrites();
+}
+
+//reads a preset into dest, from pending writes or the cache if possible
+bool readPreset(byte index, JsonDocument* dest)
+{
+  PendingPresetWrite* p = pendingPresetFind(index);
+  if (p) {
+    if (!p->json) { //deleted
+      dest->clear();
+      return false;
+    }
+    return deserializeJson(*dest, (const char*)p->json, p->len) == DeserializationError::Ok;
+  }
+
+  PresetCacheEntry* e = presetCacheFind(index);
+  if (e) {
+    presetCacheHits++;
+    e->lastUsed = ++presetCacheTick;
+    return deserializeJson(*dest, (const char*)e->json, e->len) == DeserializationError::Ok;
+  }
+
+  presetCacheMisses++;
+  if (!readObjectFromFileUsingId("/presets.json", index, dest)) return false;
+  presetCacheAdd(index, dest);
+  return true;
+}
+
+//loads a preset into the cache ahead of time, e.g. before a playlist switches to it
+void prefetchPreset(byte index)
+{
+  if (index == 0 || pendingPresetFind(index) || presetCacheFind(index)) return;
+  PooledJsonDoc doc(JSON_BUFFER_SIZE);
+  if (readObjectFromFileUsingId("/presets.json", index, doc.get())) presetCacheAdd(index, doc.get());
+}
+
 bool applyPreset(byte index)
 {
   if (index == 0) return false;
   if (fileDoc) {
-    errorFlag = readObjectFromFileUsingId("/presets.json", index, fileDoc) ? ERR_NONE : ERR_FS_PLOAD;
+    errorFlag = readPreset(index, fileDoc) ? ERR_NONE : ERR_FS_PLOAD;
     JsonObject fdo = fileDoc->as<JsonObject>();
     if (fdo["ps"] == index) fdo.remove("ps"); //remove load request for same presets to prevent recursive crash
     #ifdef WLED_DEBUG_FS
@@ -17,14 +226,16 @@ bool applyPreset(byte index)
     deserializeState(fdo);
   } else {
     DEBUGFS_PRINTLN(F("Make read buf"));
-    DynamicJsonDocument fDoc(JSON_BUFFER_SIZE);
-    errorFlag = readObjectFromFileUsingId("/presets.json", index, &fDoc) ? ERR_NONE : ERR_FS_PLOAD;
-    JsonObject fdo = fDoc.as<JsonObject>();
+    PooledJsonDoc fDoc(JSON_BUFFER_SIZE);
+    errorFlag = readPreset(index, fDoc.get()) ? ERR_NONE : ERR_FS_PLOAD;
+    JsonObject fdo = fDoc->as<JsonObject>();
     if (fdo["ps"] == index) fdo.remove("ps");
     #ifdef WLED_DEBUG_FS
-      serializeJson(fDoc, Serial);
+      serializeJson(*fDoc, Serial);
     #endif
+    fileDoc = fDoc.get(); //reused by a playlist in the preset
     deserializeState(fdo);
+    fileDoc = nullptr;
   }
 
   if (!errorFlag) {
@@ -40,17 +251,18 @@ void savePreset(byte index, bool persist, const char* pname, JsonObject saveobj)
   if (index == 0 || index > 250) return;
   bool docAlloc = (fileDoc != nullptr);
   JsonObject sObj = saveobj;
+  presetCacheRemove(index);
 
   if (!docAlloc) {
     DEBUGFS_PRINTLN(F("Allocating saving buffer"));
-    DynamicJsonDocument lDoc(JSON_BUFFER_SIZE);
-    sObj = lDoc.to<JsonObject>();
+    PooledJsonDoc lDoc(JSON_BUFFER_SIZE);
+    sObj = lDoc->to<JsonObject>();
     if (pname) sObj["n"] = pname;
     DEBUGFS_PRINTLN(F("Save current state"));
     serializeState(sObj, true);
     currentPreset = index;
 
-    writeObjectToFileUsingId("/presets.json", index, &lDoc);
+    queuePresetWrite(index, lDoc.get());
   } else { //from JSON API
     DEBUGFS_PRINTLN(F("Reuse recv buffer"));
     sObj.remove(F("psave"));
@@ -67,15 +279,13 @@ void savePreset(byte index, bool persist, const char* pname, JsonObject saveobj)
     sObj.remove(F("error"));
     sObj.remove(F("time"));
 
-    writeObjectToFileUsingId("/presets.json", index, fileDoc);
+    queuePresetWrite(index, fileDoc);
   }
   presetsModifiedTime = now(); //unix time
-  updateFSInfo();
 }
 
 void deletePreset(byte index) {
-  StaticJsonDocument<24> empty;
-  writeObjectToFileUsingId("/presets.json", index, &empty);
+  presetCacheRemove(index);
+  queuePresetWrite(index, nullptr);
   presetsModifiedTime = now(); //unix time
-  updateFSInfo();
 }
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "wled.h"
+
+/*
+ * State change queue and render task
+ *
+ * Network callbacks (JSON API, HTTP API, WebSocket, MQTT, Alexa) do not change the LED state themselves,
+ * they post a command to a lock-free single producer, single consumer ring instead. All queued commands are applied
+ * right before the next frame is rendered, so an effect never renders from a half applied change.
+ * The producer is the async TCP task (sys context on ESP8266), the consumer taskRender() in the loop or the render task.
+ * Requests that need the new state in their response wait until it is applied (ESP32), or apply it themselves (ESP8266).
+ *
+ * Render task (ESP32, compile with -D WLED_ENABLE_RENDER_TASK)
+ * strip.service() runs in a FreeRTOS task pinned to the application core instead of WLED::loop(),
+ * so frames are no longer delayed by network, JSON or file handling.
+ * Loop tasks that touch the LED state run while holding renderMutex.
+ */
+
+struct StateCommand {
+  char* data;       //null terminated copy of the request (binary for STATE_CMD_PIXELS)
+  uint16_t len;
+  byte type;
+  uint32_t client;  //WebSocket client to send the new state to, 0 for none
+  uint32_t seq;
+};
+
+StateCommand stateQueue[STATE_QUEUE_SIZE];
+byte stateQueueHead = 0;        //next slot to write, only written by the producer
+byte stateQueueTail = 0;        //next slot to read, only written by the consumer
+uint32_t stateCmdPosted = 0;    //sequence number of the last queued command
+uint32_t stateCmdApplied = 0;   //sequence number of the last applied command
+
+bool pushStateCommand(const StateCommand* cmd) {
+  byte head = stateQueueHead;
+  byte next = (head +1) % STATE_QUEUE_SIZE;
+  if (next == __atomic_load_n(&stateQueueTail, __ATOMIC_ACQUIRE)) return false; //full
+  stateQueue[head] = *cmd;
+  __atomic_store_n(&stateQueueHead, next, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool popStateCommand(StateCommand* cmd) {
+  byte tail = stateQueueTail;
+  if (tail == __atomic_load_n(&stateQueueHead, __ATOMIC_ACQUIRE)) return false; //empty
+  *cmd = stateQueue[tail];
+  __atomic_store_n(&stateQueueTail, (byte)((tail +1) % STATE_QUEUE_SIZE), __ATOMIC_RELEASE);
+  return true;
+}
+
+void applyStateCommand(StateCommand* cmd) {
+  bool verbose = false;
+  switch (cmd->type) {
+    case STATE_CMD_JSON: {
+      //full size, applyPreset() and savePreset() reuse this document via fileDoc
+      PooledJsonDoc doc(JSON_BUFFER_SIZE);
+      DeserializationError error = deserializeJson(*doc, (const char*)cmd->data, cmd->len);
+      JsonObject root = doc->as<JsonObject>();
+      if (error || root.isNull()) break;
+      fileDoc = doc.get();
+      verbose = deserializeState(root);
+      fileDoc = nullptr;
+    } break;
+    case STATE_CMD_HTTP: {
+      String req = cmd->data;
+      handleSet(nullptr, req);
+    } break;
+    case STATE_CMD_COLOR:
+      colorFromDecOrHexString(col, cmd->data);
+      colorUpdated(NOTIFIER_CALL_MODE_DIRECT_CHANGE);
+      break;
+#ifdef WLED_ENABLE_MQTT
+    case STATE_CMD_BRI:
+      parseMQTTBriPayload(cmd->data);
+      break;
+#endif
+    case STATE_CMD_ALEXA:
+      applyAlexaChange();
+      break;
+    case STATE_CMD_PIXELS:
+      handlePixelBlock((const uint8_t*)cmd->data, cmd->len);
+      break;
+  }
+  free(cmd->data);
+
+  #ifdef WLED_ENABLE_WEBSOCKETS
+  //update the WebSocket client if it asked for the state or if it takes longer than 100ms until the next broadcast
+  if (cmd->client && (verbose || millis() - lastInterfaceUpdate < 1900)) {
+    AsyncWebSocketClient* client = ws.client(cmd->client);
+    if (client) sendDataWs(client);
+  }
+  #endif
+  __atomic_store_n(&stateCmdApplied, cmd->seq, __ATOMIC_RELEASE);
+}
+
+//applies all queued state changes, called once per frame before rendering
+void handleStateQueue() {
+  StateCommand cmd;
+  while (popStateCommand(&cmd)) applyStateCommand(&cmd);
+}
+
+//parses only the keys network handlers need themselves ("v", "lv") into dest. Returns false if the request is not a valid JSON object
+bool peekStateRequest(const char* data, size_t len, JsonDocument& dest) {
+  StaticJsonDocument<32> filter;
+  filter["v"] = true;
+  filter["lv"] = true;
+  DeserializationError error = deserializeJson(dest, data, len, DeserializationOption::Filter(filter));
+  return !error && dest.is<JsonObject>();
+}
+
+//queues a state change from a network callback. Returns false if the caller has to apply it itself.
+//If wait is set, this returns once it is applied (or after STATE_CMD_TIMEOUT ms). The loop or render task runs on another core
+//than the async TCP task on ESP32, on ESP8266 it can not run while a callback waits, so the caller applies it itself there.
+//A WebSocket client id gets the new state sent like a direct WebSocket request would.
+bool postStateChange(byte type, const char* data, size_t len, bool wait, uint32_t client)
+{
+  #ifdef ESP8266
+  if (wait) return false; //the loop can not run while a callback waits on ESP8266
+  #endif
+  if (len > UINT16_MAX) return false;
+  StateCommand cmd;
+  cmd.data = (char*)malloc(len +1);
+  if (!cmd.data) return false;
+  if (len) memcpy(cmd.data, data, len);
+  cmd.data[len] = 0;
+  cmd.len = len;
+  cmd.type = type;
+  cmd.client = client;
+  cmd.seq = stateCmdPosted +1;
+
+  uint32_t start = millis();
+  while (!pushStateCommand(&cmd)) { //full
+    #ifdef ESP8266
+    free(cmd.data);
+    return false;
+    #endif
+    if (millis() - start > STATE_CMD_TIMEOUT) { //the loop or render task is stuck, drop the change
+      free(cmd.data);
+      DEBUG_PRINTLN(F("State queue full"));
+      return true;
+    }
+    delay(1);
+  }
+  stateCmdPosted = cmd.seq;
+
+  if (!wait) return true;
+  while ((int32_t)(__atomic_load_n(&stateCmdApplied, __ATOMIC_ACQUIRE) - cmd.seq) < 0) {
+    if (millis() - start > STATE_CMD_TIMEOUT) return true;
+    delay(1);
+  }
+  return true;
+}
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(WLED_ENABLE_RENDER_TASK)
+
+TaskHandle_t renderTaskHandle = nullptr;
+SemaphoreHandle_t renderMutex = nullptr;
+
+void renderTask(void* parameter) {
+  for (;;) {
+    xSemaphoreTake(renderMutex, portMAX_DELAY);
+    handleStateQueue();
+
+    uint32_t wait = RENDER_TASK_MAX_WAIT;
+    if (!offMode && (!realtimeMode || realtimeOverride)) {
+      strip.service();
+      uint32_t frame = strip.timeToNextFrame();
+      if (frame < wait) wait = frame;
+    }
+    xSemaphoreGive(renderMutex);
+    vTaskDelay(wait ? pdMS_TO_TICKS(wait) : 1); //always block for a tick so loop() gets the core
+  }
+}
+
+void startRenderTask() {
+  if (renderTaskHandle) return;
+  renderMutex = xSemaphoreCreateMutex();
+  if (!renderMutex) return;
+  xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, nullptr, RENDER_TASK_PRIORITY, &renderTaskHandle, RENDER_TASK_CORE);
+  DEBUG_PRINTLN(renderTaskHandle ? F("Render task started") : F("Render task failed"));
+}
+
+bool renderTaskActive() {
+  return renderTaskHandle != nullptr;
+}
+
+void lockStrip() {
+  if (renderMutex) xSemaphoreTake(renderMutex, portMAX_DELAY);
+}
+
+void unlockStrip() {
+  if (renderMutex) xSemaphoreGive(renderMutex);
+}
+
+#else
+
+void startRenderTask() {}
+bool renderTaskActive() { return false; }
+void lockStrip() {}
+void unlockStrip() {}
+
+#endif
@@ -0,0 +1,185 @@
+#include "wled.h"
+
+/*
+ * Event scheduler for time based actions (playlist steps, preset cycling, timers).
+ * Events are kept in a min-heap ordered by due time, so the loop only has to look at the earliest one
+ * and knows how long it may idle. There is at most one pending event of each type.
+ */
+
+struct ScheduledEvent {
+  uint32_t due;   //millis() timestamp
+  byte type;
+};
+
+ScheduledEvent eventHeap[SCHEDULER_SLOTS];
+byte eventCount = 0;
+
+//millis() comparison that is safe across rollover
+bool dueBefore(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void eventSwap(byte a, byte b) {
+  ScheduledEvent tmp = eventHeap[a];
+  eventHeap[a] = eventHeap[b];
+  eventHeap[b] = tmp;
+}
+
+void eventSiftUp(byte i) {
+  while (i > 0) {
+    byte parent = (i -1) >> 1;
+    if (!dueBefore(eventHeap[i].due, eventHeap[parent].due)) break;
+    eventSwap(i, parent);
+    i = parent;
+  }
+}
+
+void eventSiftDown(byte i) {
+  while (true) {
+    byte first = i;
+    byte l = 2*i +1, r = 2*i +2;
+    if (l < eventCount && dueBefore(eventHeap[l].due, eventHeap[first].due)) first = l;
+    if (r < eventCount && dueBefore(eventHeap[r].due, eventHeap[first].due)) first = r;
+    if (first == i) break;
+    eventSwap(i, first);
+    i = first;
+  }
+}
+
+int8_t findEvent(byte type) {
+  for (byte i = 0; i < eventCount; i++) {
+    if (eventHeap[i].type == type) return i;
+  }
+  return -1;
+}
+
+void removeEventAt(byte i) {
+  eventCount--;
+  if (i == eventCount) return;
+  eventHeap[i] = eventHeap[eventCount];
+  eventSiftDown(i);
+  eventSiftUp(i);
+}
+
+//schedules the event of the given type at the millis() timestamp due, replacing a pending one of the same type
+void scheduleEvent(byte type, uint32_t due) {
+  int8_t i = findEvent(type);
+  if (i < 0) {
+    if (eventCount >= SCHEDULER_SLOTS) return;
+    i = eventCount++;
+    eventHeap[i].type = type;
+  }
+  eventHeap[i].due = due;
+  eventSiftDown(i);
+  eventSiftUp(i);
+}
+
+void cancelEvent(byte type) {
+  int8_t i = findEvent(type);
+  if (i >= 0) removeEventAt(i);
+}
+
+//ms until the next event is due, 0 if one is due already, UINT32_MAX if none is scheduled
+uint32_t timeToNextEvent() {
+  if (!eventCount) return UINT32_MAX;
+  uint32_t nowMs = millis();
+  if (!dueBefore(nowMs, eventHeap[0].due)) return 0;
+  return eventHeap[0].due - nowMs;
+}
+
+//runs all events that are due. An event that reschedules itself as due immediately runs in the next loop
+void handleEvents() {
+  uint32_t nowMs = millis();
+  bool paused = realtimeMode && !realtimeOverride; //no playlist or preset changes during realtime
+  byte count = eventCount;
+  while (count-- && eventCount && !dueBefore(nowMs, eventHeap[0].due)) {
+    byte type = eventHeap[0].type;
+    removeEventAt(0);
+    switch (type) {
+      case EVENT_PLAYLIST:
+        if (paused) { scheduleEvent(type, nowMs + SCHEDULER_PAUSE_RETRY); break; }
+        handlePlaylist(); schedulePlaylist(); break;
+      case EVENT_PRESET_CYCLE:
+        if (paused) { scheduleEvent(type, nowMs + SCHEDULER_PAUSE_RETRY); break; }
+        handlePresetCycle(); schedulePresetCycle(); break;
+      case EVENT_TIMERS:
+        updateLocalTime(); checkTimers(); scheduleTimers(); break;
+    }
+  }
+}
+
+//gives the time until the next frame or event to other tasks (WiFi, idle task), but at most SCHEDULER_MAX_IDLE ms
+void idleUntilNextEvent() {
+  if (realtimeMode || doReboot) return; //realtime packets are polled
+  uint32_t idle = timeToNextEvent();
+  if (!offMode && !renderTaskActive()) {
+    uint32_t frame = strip.timeToNextFrame();
+    if (frame < idle) idle = frame;
+  }
+  if (idle > SCHEDULER_MAX_IDLE) idle = SCHEDULER_MAX_IDLE;
+  if (idle) delay(idle);
+}
+
+/*
+ * Cooperative task runner for WLED::loop(). Rendering has priority: before each task, a frame that is due is rendered first.
+ * A task whose average run time does not fit into the time left until the next frame is postponed,
+ * but at most TASK_MAX_POSTPONE loops in a row so that it can not starve.
+ * With the render task running, frames are rendered there and tasks are only serialized with it by renderMutex.
+ */
+LoopTask* loopTasks = nullptr;
+byte loopTaskCount = 0;
+LoopTask* renderTask = nullptr;
+
+void runTask(LoopTask* t) {
+  if (!t->unlocked) lockStrip();
+  uint32_t start = micros();
+  t->run();
+  uint32_t took = micros() - start;
+  if (!t->unlocked) unlockStrip();
+  if (took > t->maxUs) t->maxUs = took;
+  t->avgUs = t->runs ? (t->avgUs * 15 + took) >> 4 : took; //moving average over ~16 runs
+  t->runs++;
+  t->postponed = 0;
+}
+
+//ms until the next frame is rendered by the loop, UINT32_MAX if the effects are not running (off or realtime mode)
+uint32_t timeToRender() {
+  if (offMode || (realtimeMode && !realtimeOverride) || renderTaskActive()) return UINT32_MAX;
+  return strip.timeToNextFrame();
+}
+
+void runLoopTasks(LoopTask* tasks, byte count, LoopTask* render) {
+  loopTasks = tasks; loopTaskCount = count; renderTask = render;
+  for (byte i = 0; i < count; i++) {
+    uint32_t frameIn = timeToRender();
+    if (frameIn == 0) {
+      runTask(render);
+      frameIn = timeToRender();
+    }
+    LoopTask* t = &tasks[i];
+    if (frameIn != UINT32_MAX && t->avgUs > frameIn * 1000 && t->postponed < TASK_MAX_POSTPONE) {
+      t->postponed++;
+      t->skips++;
+      continue;
+    }
+    runTask(t);
+    yield();
+  }
+  if (!renderTaskActive()) runTask(render);
+}
+
+//per task timing, all times in us
+void serializeTasks(JsonObject root)
+{
+  JsonArray tasks = root.createNestedArray(F("tasks"));
+  for (byte i = 0; i <= loopTaskCount; i++) {
+    LoopTask* t = (i < loopTaskCount) ? &loopTasks[i] : renderTask;
+    if (!t) break;
+    JsonObject task = tasks.createNestedObject();
+    task["n"] = t->name;
+    task[F("max")] = t->maxUs;
+    task[F("avg")] = t->avgUs;
+    task[F("runs")] = t->runs;
+    task[F("skip")] = t->skips;
+  }
+}
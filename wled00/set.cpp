@@ -1,4 +1,5 @@
 #include "wled.h"
+#include "api_args.h"
 
 /*
  * Receives client input
@@ -103,6 +104,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     if (t > 0) transitionDelay = t;
     transitionDelayDefault = t;
     strip.paletteFade = request->hasArg(F("PF"));
+    strip.effectFade = request->hasArg(F("EF"));
 
     nightlightTargetBri = request->arg(F("TB")).toInt();
     t = request->arg(F("TL")).toInt();
@@ -116,6 +118,8 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     skipFirstLed = request->hasArg(F("SL"));
     t = request->arg(F("BF")).toInt();
     if (t > 0) briMultiplier = t;
+    t = request->arg(F("FR")).toInt();
+    strip.setTargetFps(constrain(t, 1, WLED_FPS_MAX)); //clamp before it is narrowed to uint8_t
   }
 
   //UI
@@ -145,6 +149,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     notifyHue = request->hasArg(F("SH"));
     notifyMacro = request->hasArg(F("SM"));
     notifyTwice = request->hasArg(F("S2"));
+    strip.deterministicMode = request->hasArg(F("DE"));
 
     receiveDirect = request->hasArg(F("RD"));
     e131SkipOutOfSequence = request->hasArg(F("ES"));
@@ -185,6 +190,8 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     strlcpy(mqttClientID, request->arg(F("MQCID")).c_str(), 41);
     strlcpy(mqttDeviceTopic, request->arg(F("MD")).c_str(), 33);
     strlcpy(mqttGroupTopic, request->arg(F("MG")).c_str(), 33);
+    t = request->arg(F("MQPERF")).toInt();
+    if (t >= 0 && t <= 3600) perfMqttInterval = t;
     #endif
 
     #ifndef WLED_DISABLE_HUESYNC
@@ -276,6 +283,8 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     {
       WLED_FS.format();
       clearEEPROM();
+      clearPresetWrites();
+      doSerializeConfig = false;
       serveMessage(request, 200, F("All Settings erased."), F("Connect to WLED-AP to setup again"),255);
       doReboot = true;
     }
@@ -330,7 +339,11 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
   }
   
   #endif
-  if (subPage != 6 || !doReboot) serializeConfig(); //do not save if factory reset
+  if (subPage != 6 || !doReboot) { //do not save if factory reset
+    if (doSerializeConfig) fsWritesAvoided++;
+    doSerializeConfig = true; //written in loop once there were no changes for a while
+    lastConfigChange = millis();
+  }
   if (subPage == 2) {
     strip.init(useRGBW,ledCount,skipFirstLed);
   }
@@ -338,39 +351,37 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
 }
 
 
-
-//helper to get int value at a position in string
-int getNumVal(const String* req, uint16_t pos)
+//helper to get int value of an API argument
+int getNumVal(const char* val)
 {
-  return req->substring(pos+3).toInt();
+  return atoi(val);
 }
 
 
-//helper to get int value at a position in string
-bool updateVal(const String* req, const char* key, byte* val, byte minv, byte maxv)
+//helper to update a byte value from an API argument, supports relative changes ("~10", "~-10") and cycling ("~", "~-")
+bool updateVal(const char* val, byte* dest, byte minv, byte maxv)
 {
-  int pos = req->indexOf(key);
-  if (pos < 1) return false;
+  if (!val) return false;
 
-  if (req->charAt(pos+3) == '~') {
-    int out = getNumVal(req, pos+1);
+  if (val[0] == '~') {
+    int out = getNumVal(val +1);
     if (out == 0)
     {
-      if (req->charAt(pos+4) == '-')
+      if (val[1] == '-')
       {
-        *val = (*val <= minv)? maxv : *val -1;
+        *dest = (*dest <= minv)? maxv : *dest -1;
       } else {
-        *val = (*val >= maxv)? minv : *val +1;
+        *dest = (*dest >= maxv)? minv : *dest +1;
       }
     } else {
-      out += *val;
+      out += *dest;
       if (out > maxv) out = maxv;
       if (out < minv) out = minv;
-      *val = out;
+      *dest = out;
     }
   } else
   {
-    *val = getNumVal(req, pos);
+    *dest = getNumVal(val);
   }
   return true;
 }
@@ -381,10 +392,12 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
 {
   if (!(req.indexOf("win") >= 0)) return false;
 
-  int pos = 0;
+  const char* v;
   DEBUG_PRINT(F("API req: "));
   DEBUG_PRINTLN(req);
 
+  ApiArgs args(req.c_str());
+
   strip.applyToAllSelected = false;
   //snapshot to check if request changed values later, temporary.
   byte prevCol[4] = {col[0], col[1], col[2], col[3]};
@@ -396,23 +409,23 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
 
   //segment select (sets main segment)
   byte prevMain = strip.getMainSegmentId();
-  pos = req.indexOf(F("SM="));
-  if (pos > 0) {
-    strip.mainSegment = getNumVal(&req, pos);
+  v = args.get(F("SM"));
+  if (v) {
+    strip.mainSegment = getNumVal(v);
   }
   byte selectedSeg = strip.getMainSegmentId();
   if (selectedSeg != prevMain) setValuesFromMainSeg();
 
-  pos = req.indexOf(F("SS="));
-  if (pos > 0) {
-    byte t = getNumVal(&req, pos);
+  v = args.get(F("SS"));
+  if (v) {
+    byte t = getNumVal(v);
     if (t < strip.getMaxSegments()) selectedSeg = t;
   }
 
   WS2812FX::Segment& mainseg = strip.getSegment(selectedSeg);
-  pos = req.indexOf(F("SV=")); //segment selected
-  if (pos > 0) {
-    byte t = getNumVal(&req, pos);
+  v = args.get(F("SV")); //segment selected
+  if (v) {
+    byte t = getNumVal(v);
     if (t == 2) {
       for (uint8_t i = 0; i < strip.getMaxSegments(); i++)
       {
@@ -426,82 +439,84 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   uint16_t stopI = mainseg.stop;
   uint8_t grpI = mainseg.grouping;
   uint16_t spcI = mainseg.spacing;
-  pos = req.indexOf(F("&S=")); //segment start
-  if (pos > 0) {
-    startI = getNumVal(&req, pos);
+  v = args.get(F("S")); //segment start
+  if (v) {
+    startI = getNumVal(v);
   }
-  pos = req.indexOf(F("S2=")); //segment stop
-  if (pos > 0) {
-    stopI = getNumVal(&req, pos);
+  v = args.get(F("S2")); //segment stop
+  if (v) {
+    stopI = getNumVal(v);
   }
-  pos = req.indexOf(F("GP=")); //segment grouping
-  if (pos > 0) {
-    grpI = getNumVal(&req, pos);
+  v = args.get(F("GP")); //segment grouping
+  if (v) {
+    grpI = getNumVal(v);
     if (grpI == 0) grpI = 1;
   }
-  pos = req.indexOf(F("SP=")); //segment spacing
-  if (pos > 0) {
-    spcI = getNumVal(&req, pos);
+  v = args.get(F("SP")); //segment spacing
+  if (v) {
+    spcI = getNumVal(v);
   }
   strip.setSegment(selectedSeg, startI, stopI, grpI, spcI);
 
    //set presets
-  pos = req.indexOf(F("P1=")); //sets first preset for cycle
-  if (pos > 0) presetCycleMin = getNumVal(&req, pos);
+  v = args.get(F("P1")); //sets first preset for cycle
+  if (v) presetCycleMin = getNumVal(v);
 
-  pos = req.indexOf(F("P2=")); //sets last preset for cycle
-  if (pos > 0) presetCycleMax = getNumVal(&req, pos);
+  v = args.get(F("P2")); //sets last preset for cycle
+  if (v) presetCycleMax = getNumVal(v);
 
   //preset cycle
-  pos = req.indexOf(F("CY="));
-  if (pos > 0)
+  v = args.get(F("CY"));
+  if (v)
   {
-    char cmd = req.charAt(pos+3);
+    char cmd = v[0];
     if (cmd == '2') presetCyclingEnabled = !presetCyclingEnabled;
     else presetCyclingEnabled = (cmd != '0');
     presetCycCurr = presetCycleMin;
+    schedulePresetCycle();
   }
 
-  pos = req.indexOf(F("PT=")); //sets cycle time in ms
-  if (pos > 0) {
-    int v = getNumVal(&req, pos);
-    if (v > 100) presetCycleTime = v/100;
+  v = args.get(F("PT")); //sets cycle time in ms
+  if (v) {
+    int t = getNumVal(v);
+    if (t > 100) presetCycleTime = t/100;
+    schedulePresetCycle();
   }
 
-  pos = req.indexOf(F("PS=")); //saves current in preset
-  if (pos > 0) savePreset(getNumVal(&req, pos));
+  v = args.get(F("PS")); //saves current in preset
+  if (v) savePreset(getNumVal(v));
 
   //apply preset
-  if (updateVal(&req, "PL=", &presetCycCurr, presetCycleMin, presetCycleMax)) {
+  if (updateVal(args.get(F("PL")), &presetCycCurr, presetCycleMin, presetCycleMax)) {
     applyPreset(presetCycCurr);
   }
 
   //set brightness
-  updateVal(&req, "&A=", &bri);
+  updateVal(args.get(F("A")), &bri);
 
   //set colors
-  updateVal(&req, "&R=", &col[0]);
-  updateVal(&req, "&G=", &col[1]);
-  updateVal(&req, "&B=", &col[2]);
-  updateVal(&req, "&W=", &col[3]);
-  updateVal(&req, "R2=", &colSec[0]);
-  updateVal(&req, "G2=", &colSec[1]);
-  updateVal(&req, "B2=", &colSec[2]);
-  updateVal(&req, "W2=", &colSec[3]);
+  updateVal(args.get(F("R")), &col[0]);
+  updateVal(args.get(F("G")), &col[1]);
+  updateVal(args.get(F("B")), &col[2]);
+  updateVal(args.get(F("W")), &col[3]);
+  updateVal(args.get(F("R2")), &colSec[0]);
+  updateVal(args.get(F("G2")), &colSec[1]);
+  updateVal(args.get(F("B2")), &colSec[2]);
+  updateVal(args.get(F("W2")), &colSec[3]);
 
   #ifdef WLED_ENABLE_LOXONE
   //lox parser
-  pos = req.indexOf(F("LX=")); // Lox primary color
-  if (pos > 0) {
-    int lxValue = getNumVal(&req, pos);
+  v = args.get(F("LX")); // Lox primary color
+  if (v) {
+    int lxValue = getNumVal(v);
     if (parseLx(lxValue, col)) {
       bri = 255;
       nightlightActive = false; //always disable nightlight when toggling
     }
   }
-  pos = req.indexOf(F("LY=")); // Lox secondary color
-  if (pos > 0) {
-    int lxValue = getNumVal(&req, pos);
+  v = args.get(F("LY")); // Lox secondary color
+  if (v) {
+    int lxValue = getNumVal(v);
     if(parseLx(lxValue, colSec)) {
       bri = 255;
       nightlightActive = false; //always disable nightlight when toggling
@@ -511,36 +526,36 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   #endif
 
   //set hue
-  pos = req.indexOf(F("HU="));
-  if (pos > 0) {
-    uint16_t temphue = getNumVal(&req, pos);
+  v = args.get(F("HU"));
+  if (v) {
+    uint16_t temphue = getNumVal(v);
     byte tempsat = 255;
-    pos = req.indexOf(F("SA="));
-    if (pos > 0) {
-      tempsat = getNumVal(&req, pos);
+    v = args.get(F("SA"));
+    if (v) {
+      tempsat = getNumVal(v);
     }
-    colorHStoRGB(temphue,tempsat,(req.indexOf(F("H2"))>0)? colSec:col);
+    colorHStoRGB(temphue,tempsat,(args.has(F("H2")))? colSec:col);
   }
 
   //set white spectrum (kelvin)
-  pos = req.indexOf(F("&K="));
-  if (pos > 0) {
-    colorKtoRGB(getNumVal(&req, pos),(req.indexOf(F("K2"))>0)? colSec:col);
+  v = args.get(F("K"));
+  if (v) {
+    colorKtoRGB(getNumVal(v),(args.has(F("K2")))? colSec:col);
   }
 
   //set color from HEX or 32bit DEC
-  pos = req.indexOf(F("CL="));
-  if (pos > 0) {
-    colorFromDecOrHexString(col, (char*)req.substring(pos + 3).c_str());
+  v = args.get(F("CL"));
+  if (v) {
+    colorFromDecOrHexString(col, (char*)v);
   }
-  pos = req.indexOf(F("C2="));
-  if (pos > 0) {
-    colorFromDecOrHexString(colSec, (char*)req.substring(pos + 3).c_str());
+  v = args.get(F("C2"));
+  if (v) {
+    colorFromDecOrHexString(colSec, (char*)v);
   }
-  pos = req.indexOf(F("C3="));
-  if (pos > 0) {
+  v = args.get(F("C3"));
+  if (v) {
     byte t[4];
-    colorFromDecOrHexString(t, (char*)req.substring(pos + 3).c_str());
+    colorFromDecOrHexString(t, (char*)v);
     if (selectedSeg != strip.getMainSegmentId()) {
       strip.applyToAllSelected = true;
       strip.setColor(2, t[0], t[1], t[2], t[3]);
@@ -550,14 +565,13 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //set to random hue SR=0->1st SR=1->2nd
-  pos = req.indexOf(F("SR"));
-  if (pos > 0) {
-    _setRandomColor(getNumVal(&req, pos));
+  if (args.has(F("SR"))) {
+    v = args.get(F("SR"));
+    _setRandomColor(v ? getNumVal(v) : 0);
   }
 
   //swap 2nd & 1st
-  pos = req.indexOf(F("SC"));
-  if (pos > 0) {
+  if (args.has(F("SC"))) {
     byte temp;
     for (uint8_t i=0; i<4; i++)
     {
@@ -568,40 +582,40 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //set effect parameters
-  if (updateVal(&req, "FX=", &effectCurrent, 0, strip.getModeCount()-1)) presetCyclingEnabled = false;
-  updateVal(&req, "SX=", &effectSpeed);
-  updateVal(&req, "IX=", &effectIntensity);
-  updateVal(&req, "FP=", &effectPalette, 0, strip.getPaletteCount()-1);
+  if (updateVal(args.get(F("FX")), &effectCurrent, 0, strip.getModeCount()-1)) presetCyclingEnabled = false;
+  updateVal(args.get(F("SX")), &effectSpeed);
+  updateVal(args.get(F("IX")), &effectIntensity);
+  updateVal(args.get(F("FP")), &effectPalette, 0, strip.getPaletteCount()-1);
 
   //set advanced overlay
-  pos = req.indexOf(F("OL="));
-  if (pos > 0) {
-    overlayCurrent = getNumVal(&req, pos);
+  v = args.get(F("OL"));
+  if (v) {
+    overlayCurrent = getNumVal(v);
   }
 
   //apply macro (deprecated, added for compatibility with pre-0.11 automations)
-  pos = req.indexOf(F("&M="));
-  if (pos > 0) {
-    applyPreset(getNumVal(&req, pos) + 16);
+  v = args.get(F("M"));
+  if (v) {
+    applyPreset(getNumVal(v) + 16);
   }
 
   //toggle send UDP direct notifications
-  pos = req.indexOf(F("SN="));
-  if (pos > 0) notifyDirect = (req.charAt(pos+3) != '0');
+  v = args.get(F("SN"));
+  if (v) notifyDirect = (v[0] != '0');
 
   //toggle receive UDP direct notifications
-  pos = req.indexOf(F("RN="));
-  if (pos > 0) receiveNotifications = (req.charAt(pos+3) != '0');
+  v = args.get(F("RN"));
+  if (v) receiveNotifications = (v[0] != '0');
 
   //receive live data via UDP/Hyperion
-  pos = req.indexOf(F("RD="));
-  if (pos > 0) receiveDirect = (req.charAt(pos+3) != '0');
+  v = args.get(F("RD"));
+  if (v) receiveDirect = (v[0] != '0');
 
   //main toggle on/off (parse before nightlight, #1214)
-  pos = req.indexOf(F("&T="));
-  if (pos > 0) {
+  v = args.get(F("T"));
+  if (v) {
     nightlightActive = false; //always disable nightlight when toggling
-    switch (getNumVal(&req, pos))
+    switch (getNumVal(v))
     {
       case 0: if (bri != 0){briLast = bri; bri = 0;} break; //off, only if it was previously on
       case 1: if (bri == 0) bri = briLast; break; //on, only if it was previously off
@@ -610,17 +624,16 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //toggle nightlight mode
-  bool aNlDef = false;
-  if (req.indexOf(F("&ND")) > 0) aNlDef = true;
-  pos = req.indexOf(F("NL="));
-  if (pos > 0)
+  bool aNlDef = args.has(F("ND"));
+  v = args.get(F("NL"));
+  if (v)
   {
-    if (req.charAt(pos+3) == '0')
+    if (v[0] == '0')
     {
       nightlightActive = false;
     } else {
       nightlightActive = true;
-      if (!aNlDef) nightlightDelayMins = getNumVal(&req, pos);
+      if (!aNlDef) nightlightDelayMins = getNumVal(v);
       nightlightStartTime = millis();
     }
   } else if (aNlDef)
@@ -630,17 +643,17 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //set nightlight target brightness
-  pos = req.indexOf(F("NT="));
-  if (pos > 0) {
-    nightlightTargetBri = getNumVal(&req, pos);
+  v = args.get(F("NT"));
+  if (v) {
+    nightlightTargetBri = getNumVal(v);
     nightlightActiveOld = false; //re-init
   }
 
   //toggle nightlight fade
-  pos = req.indexOf(F("NF="));
-  if (pos > 0)
+  v = args.get(F("NF"));
+  if (v)
   {
-    nightlightMode = getNumVal(&req, pos);
+    nightlightMode = getNumVal(v);
 
     nightlightActiveOld = false; //re-init
   }
@@ -648,29 +661,29 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
 
   #if AUXPIN >= 0
   //toggle general purpose output
-  pos = req.indexOf(F("AX="));
-  if (pos > 0) {
-    auxTime = getNumVal(&req, pos);
+  v = args.get(F("AX"));
+  if (v) {
+    auxTime = getNumVal(v);
     auxActive = true;
     if (auxTime == 0) auxActive = false;
   }
   #endif
 
-  pos = req.indexOf(F("TT="));
-  if (pos > 0) transitionDelay = getNumVal(&req, pos);
+  v = args.get(F("TT"));
+  if (v) transitionDelay = getNumVal(v);
 
   //Segment reverse
-  pos = req.indexOf(F("RV="));
-  if (pos > 0) strip.getSegment(selectedSeg).setOption(SEG_OPTION_REVERSED, req.charAt(pos+3) != '0');
+  v = args.get(F("RV"));
+  if (v) strip.getSegment(selectedSeg).setOption(SEG_OPTION_REVERSED, v[0] != '0');
 
   //Segment reverse
-  pos = req.indexOf(F("MI="));
-  if (pos > 0) strip.getSegment(selectedSeg).setOption(SEG_OPTION_MIRROR, req.charAt(pos+3) != '0');
+  v = args.get(F("MI"));
+  if (v) strip.getSegment(selectedSeg).setOption(SEG_OPTION_MIRROR, v[0] != '0');
 
   //Segment brightness/opacity
-  pos = req.indexOf(F("SB="));
-  if (pos > 0) {
-    byte segbri = getNumVal(&req, pos);
+  v = args.get(F("SB"));
+  if (v) {
+    byte segbri = getNumVal(v);
     strip.getSegment(selectedSeg).setOption(SEG_OPTION_ON, segbri, selectedSeg);
     if (segbri) {
       strip.getSegment(selectedSeg).setOpacity(segbri, selectedSeg);
@@ -678,55 +691,54 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //set time (unix timestamp)
-  pos = req.indexOf(F("ST="));
-  if (pos > 0) {
-    setTime(getNumVal(&req, pos));
+  v = args.get(F("ST"));
+  if (v) {
+    setTime(getNumVal(v));
   }
 
   //set countdown goal (unix timestamp)
-  pos = req.indexOf(F("CT="));
-  if (pos > 0) {
-    countdownTime = getNumVal(&req, pos);
+  v = args.get(F("CT"));
+  if (v) {
+    countdownTime = getNumVal(v);
     if (countdownTime - now() > 0) countdownOverTriggered = false;
   }
 
-  pos = req.indexOf(F("LO="));
-  if (pos > 0) {
-    realtimeOverride = getNumVal(&req, pos);
+  v = args.get(F("LO"));
+  if (v) {
+    realtimeOverride = getNumVal(v);
     if (realtimeOverride > 2) realtimeOverride = REALTIME_OVERRIDE_ALWAYS;
   }
 
-  pos = req.indexOf(F("RB"));
-  if (pos > 0) doReboot = true;
+  if (args.has(F("RB"))) doReboot = true;
 
   //cronixie
   #ifndef WLED_DISABLE_CRONIXIE
   //mode, 1 countdown
-  pos = req.indexOf(F("NM="));
-  if (pos > 0) countdownMode = (req.charAt(pos+3) != '0');
+  v = args.get(F("NM"));
+  if (v) countdownMode = (v[0] != '0');
   
-  pos = req.indexOf(F("NX=")); //sets digits to code
-  if (pos > 0) {
-    strlcpy(cronixieDisplay, req.substring(pos + 3, pos + 9).c_str(), 6);
+  v = args.get(F("NX")); //sets digits to code
+  if (v) {
+    strlcpy(cronixieDisplay, v, 6);
     setCronixie();
   }
 
-  pos = req.indexOf(F("NB="));
-  if (pos > 0) //sets backlight
+  v = args.get(F("NB"));
+  if (v) //sets backlight
   {
-    cronixieBacklight = (req.charAt(pos+3) != '0');
+    cronixieBacklight = (v[0] != '0');
     overlayRefreshedTime = 0;
   }
   #endif
 
-  pos = req.indexOf(F("U0=")); //user var 0
-  if (pos > 0) {
-    userVar0 = getNumVal(&req, pos);
+  v = args.get(F("U0")); //user var 0
+  if (v) {
+    userVar0 = getNumVal(v);
   }
 
-  pos = req.indexOf(F("U1=")); //user var 1
-  if (pos > 0) {
-    userVar1 = getNumVal(&req, pos);
+  v = args.get(F("U1")); //user var 1
+  if (v) {
+    userVar1 = getNumVal(v);
   }
   //you can add more if you need
 
@@ -740,7 +752,7 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   {
     WS2812FX::Segment& seg = strip.getSegment(i);
     if (!seg.isSelected()) continue;
-    if (effectCurrent != prevEffect) seg.mode = effectCurrent;
+    if (effectCurrent != prevEffect) strip.setMode(i, effectCurrent);
     if (effectSpeed != prevSpeed) seg.speed = effectSpeed;
     if (effectIntensity != prevIntensity) seg.intensity = effectIntensity;
     if (effectPalette != prevPalette) seg.palette = effectPalette;
@@ -763,13 +775,12 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   if (!apply) return true; //when called by JSON API, do not call colorUpdated() here
   
   //internal call, does not send XML response
-  pos = req.indexOf(F("IN"));
-  if (pos < 1) XML_response(request);
+  if (!args.has(F("IN"))) XML_response(request);
 
   strip.applyToAllSelected = false;
 
-  pos = req.indexOf(F("&NN")); //do not send UDP notifications this time
-  colorUpdated((pos > 0) ? NOTIFIER_CALL_MODE_NO_NOTIFY : NOTIFIER_CALL_MODE_DIRECT_CHANGE);
+  //do not send UDP notifications this time
+  colorUpdated((args.has(F("NN"))) ? NOTIFIER_CALL_MODE_NO_NOTIFY : NOTIFIER_CALL_MODE_DIRECT_CHANGE);
 
   return true;
 }
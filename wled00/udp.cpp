@@ -81,6 +81,7 @@ void realtimeLock(uint32_t timeoutMs, byte md)
     }
   }
 
+  if (md != REALTIME_MODE_GENERIC) realtimePackets++;
   realtimeTimeout = millis() + timeoutMs;
   if (timeoutMs == 255001 || timeoutMs == 65000) realtimeTimeout = UINT32_MAX;
   realtimeMode = md;
@@ -328,9 +329,9 @@ void handleNotifications()
     apireq += (char*)udpIn;
     handleSet(nullptr, apireq);
   } else if (udpIn[0] == '{') { //JSON API
-    DynamicJsonDocument jsonBuffer(2048);
-    DeserializationError error = deserializeJson(jsonBuffer, udpIn);
-    JsonObject root = jsonBuffer.as<JsonObject>();
+    PooledJsonDoc jsonBuffer(jsonSizeForInput(packetSize));
+    DeserializationError error = deserializeJson(*jsonBuffer, udpIn, packetSize);
+    JsonObject root = jsonBuffer->as<JsonObject>();
     if (!error && !root.isNull()) deserializeState(root);
   }
 }
@@ -65,6 +65,12 @@ void WLED::reset()
     yield(); // enough time to send response to client
   }
   setAllLeds();
+  //write pending changes before restarting
+  flushPresetWrites();
+  if (doSerializeConfig)
+    serializeConfig();
+  if (doCloseFile)
+    closeFile();
   DEBUG_PRINTLN("MODULE RESET");
   ESP.restart();
 }
@@ -161,82 +167,112 @@ void WiFiEvent(WiFiEvent_t event)
   }
 }
 
-void WLED::loop()
-{
-  handleIR(); // 2nd call to function needed for ESP32 to return valid results -- should be good for ESP8266, too
-  handleConnection();
-  handleSerial();
-  handleConfigSerial();
-  handleNotifications();
-  handleTransitions();
-#ifdef WLED_ENABLE_DMX
-  handleDMX();
-#endif
-  userLoop();
-  usermods.loop();
-
-  yield();
-  handleIO();
-  handleIR();
-  handleNetworkTime();
-  handleAlexa();
+/*
+ * Tasks run by WLED::loop() in this order. Rendering (strip.service()) is not in the list,
+ * runLoopTasks() runs it between tasks whenever a frame is due and once at the end of every loop, unless the render task renders.
+ * Queued state changes from network callbacks are applied right before rendering.
+ * Tasks marked true do not touch the LED state and run without holding the render task lock.
+ */
+bool effectsRunning() { return !realtimeMode || realtimeOverride; } // block stuff if WARLS/Adalight is enabled
 
-  handleOverlays();
-  yield();
+void taskConnection() { WLED::instance().handleConnection(); }
+void taskSerial() { handleSerial(); handleConfigSerial(); }
+void taskUsermods() { userLoop(); usermods.loop(); }
 #ifdef WLED_USE_ANALOG_LEDS
-  strip.setRgbwPwm();
+void taskPwm() { strip.setRgbwPwm(); }
 #endif
 
+void taskFilesystem()
+{
   if (doReboot)
-    reset();
+    WLED::instance().reset();
   if (doCloseFile)
-  {
     closeFile();
-    yield();
-  }
+  handlePresetWrites();
+  if (doSerializeConfig && millis() - lastConfigChange > WRITE_COALESCE_IDLE)
+    serializeConfig();
+  handlePresetCompaction();
+}
 
-  if (!realtimeMode || realtimeOverride) // block stuff if WARLS/Adalight is enabled
-  {
-    if (apActive)
-      dnsServer.processNextRequest();
+void taskNetwork()
+{
+  if (!effectsRunning()) return;
+  if (apActive)
+    dnsServer.processNextRequest();
 #ifndef WLED_DISABLE_OTA
-    if (WLED_CONNECTED && aOtaEnabled)
-      ArduinoOTA.handle();
+  if (WLED_CONNECTED && aOtaEnabled)
+    ArduinoOTA.handle();
 #endif
-    handleNightlight();
-    handlePlaylist();
-    yield();
-
-    handleHue();
-    handleBlynk();
-
-    /*if (presetToApply) {
-      applyPreset(presetToApply);
-      presetToApply = 0;
-    }*/
+}
 
-    yield();
+void taskNightlight() { if (effectsRunning()) handleNightlight(); }
+void taskHue() { if (effectsRunning()) handleHue(); }
+void taskBlynk() { if (effectsRunning()) handleBlynk(); }
 
-    if (!offMode)
-      strip.service();
-#ifdef ESP8266
-    else if (!noWifiSleep)
-      delay(1); //required to make sure ESP enters modem sleep (see #1184)
-#endif
-  }
-  yield();
-#ifdef ESP8266
-  MDNS.update();
-#endif
+void taskMqtt()
+{
   if (millis() - lastMqttReconnectAttempt > 30000)
   {
     if (lastMqttReconnectAttempt > millis())
       rolloverMillis++; //millis() rolls over every 50 days
     initMqtt();
   }
-  yield();
-  handleWs();
-  handleStatusLED();
+}
+
+#ifdef ESP8266
+void taskMdns() { MDNS.update(); }
+#endif
+void taskStatusLed() { WLED::instance().handleStatusLED(); }
+
+void taskRender()
+{
+  handleStateQueue();
+  if (!effectsRunning()) return;
+  if (!offMode)
+    strip.service();
+#ifdef ESP8266
+  else if (!noWifiSleep)
+    delay(1); //required to make sure ESP enters modem sleep (see #1184)
+#endif
+}
+
+LoopTask loopTaskList[] = {
+  {"ir", handleIR}, // 2nd call to function needed for ESP32 to return valid results -- should be good for ESP8266, too
+  {"conn", taskConnection},
+  {"serial", taskSerial},
+  {"udp", handleNotifications},
+  {"trans", handleTransitions},
+#ifdef WLED_ENABLE_DMX
+  {"dmx", handleDMX},
+#endif
+  {"um", taskUsermods},
+  {"io", handleIO},
+  {"ir2", handleIR},
+  {"ntp", handleNetworkTime, true},
+  {"alexa", handleAlexa},
+  {"overlay", handleOverlays},
+  {"events", handleEvents},
+#ifdef WLED_USE_ANALOG_LEDS
+  {"pwm", taskPwm},
+#endif
+  {"fs", taskFilesystem},
+  {"net", taskNetwork, true},
+  {"nl", taskNightlight},
+  {"hue", taskHue},
+  {"blynk", taskBlynk},
+#ifdef ESP8266
+  {"mdns", taskMdns, true},
+#endif
+  {"mqtt", taskMqtt, true},
+  {"ws", handleWs},
+  {"led", taskStatusLed, true},
+};
+LoopTask renderLoopTask = {"render", taskRender};
+
+void WLED::loop()
+{
+  handlePerf();
+  runLoopTasks(loopTaskList, sizeof(loopTaskList) / sizeof(LoopTask), &renderLoopTask);
 
 // DEBUG serial logging
 #ifdef WLED_DEBUG
@@ -270,6 +306,7 @@ void WLED::loop()
   }
   loops++;
 #endif // WLED_DEBUG
+  idleUntilNextEvent();
 }
 
 void WLED::setup()
@@ -313,8 +350,12 @@ void WLED::setup()
     DEBUGFS_PRINTLN(F("FS failed!"));
     errorFlag = ERR_FS_BEGIN;
   }
-  else
+  else {
+    recoverFile("/cfg.json");
+    recoverFile("/wsec.json");
+    recoverFile("/presets.json");
     deEEP();
+  }
   updateFSInfo();
   deserializeConfig();
 
@@ -374,6 +415,10 @@ void WLED::setup()
 #endif
   // HTTP server page init
   initServer();
+
+  scheduleTimers();
+  schedulePresetCycle();
+  startRenderTask();
 }
 
 void WLED::beginStrip()
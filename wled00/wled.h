@@ -283,6 +283,7 @@ WLED_GLOBAL char mqttUser[41] _INIT("");                   // optional: username
 WLED_GLOBAL char mqttPass[41] _INIT("");                   // optional: password for MQTT auth
 WLED_GLOBAL char mqttClientID[41] _INIT("");               // override the client ID
 WLED_GLOBAL uint16_t mqttPort _INIT(1883);
+WLED_GLOBAL uint16_t perfMqttInterval _INIT(0);            // seconds between publishing performance counters to <device topic>/perf, 0 = off
 
 WLED_GLOBAL bool huePollingEnabled _INIT(false);           // poll hue bridge for light state
 WLED_GLOBAL uint16_t huePollIntervalMs _INIT(2500);        // low values (< 1sec) may cause lag but offer quicker response
@@ -453,6 +454,8 @@ WLED_GLOBAL byte realtimeMode _INIT(REALTIME_MODE_INACTIVE);
 WLED_GLOBAL byte realtimeOverride _INIT(REALTIME_OVERRIDE_NONE);
 WLED_GLOBAL IPAddress realtimeIP _INIT((0, 0, 0, 0));
 WLED_GLOBAL unsigned long realtimeTimeout _INIT(0);
+WLED_GLOBAL uint32_t realtimePackets _INIT(0);             // realtime packets received
+WLED_GLOBAL uint32_t realtimeDrops _INIT(0);               // realtime packets skipped because they were out of sequence
 WLED_GLOBAL uint8_t tpmPacketCount _INIT(0);
 WLED_GLOBAL uint16_t tpmPayloadFrameSize _INIT(0);
 
@@ -498,9 +501,18 @@ WLED_GLOBAL size_t fsBytesTotal _INIT(0);
 WLED_GLOBAL unsigned long presetsModifiedTime _INIT(0L);
 WLED_GLOBAL JsonDocument* fileDoc;
 WLED_GLOBAL bool doCloseFile _INIT(false);
+WLED_GLOBAL bool doSerializeConfig _INIT(false);
+WLED_GLOBAL unsigned long lastConfigChange _INIT(0);
+WLED_GLOBAL uint32_t fsWritesAvoided _INIT(0);        // flash writes saved by merging changes that happened in quick succession
+
+// JSON buffer usage
+WLED_GLOBAL size_t jsonPeakUsage _INIT(0);              // largest number of bytes used by a single JSON document
+WLED_GLOBAL uint16_t jsonPoolBusyCount _INIT(0);        // how often the shared JSON buffer was in use and a heap document was needed
 
 // presets
 WLED_GLOBAL int16_t currentPreset _INIT(-1);
+WLED_GLOBAL uint32_t presetCacheHits _INIT(0);
+WLED_GLOBAL uint32_t presetCacheMisses _INIT(0);
 WLED_GLOBAL bool isPreset _INIT(false);
 
 WLED_GLOBAL byte errorFlag _INIT(0);
@@ -76,16 +76,35 @@ void initServer()
     serveJson(request);
   });
 
+  //binary pixel block upload, needs to be added before the JSON handler as that one also matches /json/*
+  server.on("/json/pixels", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (!request->_tempObject || !postPixelBlock((uint8_t*)(request->_tempObject), request->contentLength())) {
+      request->send(400, "application/json", F("{\"error\":9}")); return;
+    }
+    request->send(200, "application/json", F("{\"success\":true}"));
+  }, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+    if (index == 0 && !request->_tempObject && total <= PIXEL_BLOCK_MAX_SIZE) request->_tempObject = malloc(total);
+    if (request->_tempObject) memcpy((uint8_t*)(request->_tempObject) + index, data, len);
+  });
+
   AsyncCallbackJsonWebHandler* handler = new AsyncCallbackJsonWebHandler("/json", [](AsyncWebServerRequest *request) {
-    bool verboseResponse = false;
-    { //scope JsonDocument so it releases its buffer
-      DynamicJsonDocument jsonBuffer(JSON_BUFFER_SIZE);
-      DeserializationError error = deserializeJson(jsonBuffer, (uint8_t*)(request->_tempObject));
-      JsonObject root = jsonBuffer.as<JsonObject>();
+    const char* body = (const char*)(request->_tempObject);
+    size_t len = request->contentLength();
+    StaticJsonDocument<64> peek;
+    if (!body || !peekStateRequest(body, len, peek)) {
+      request->send(400, "application/json", F("{\"error\":9}")); return;
+    }
+    bool verboseResponse = peek["v"] | false;
+    //changes that do not respond with the new state are applied with the next frame
+    if (!postStateChange(STATE_CMD_JSON, body, len, verboseResponse)) { //scope JsonDocument so it releases its buffer
+      //full size, applyPreset() and savePreset() reuse this document via fileDoc
+      PooledJsonDoc jsonBuffer(JSON_BUFFER_SIZE);
+      DeserializationError error = deserializeJson(*jsonBuffer, body, len);
+      JsonObject root = jsonBuffer->as<JsonObject>();
       if (error || root.isNull()) {
         request->send(400, "application/json", F("{\"error\":9}")); return;
       }
-      fileDoc = &jsonBuffer;
+      fileDoc = jsonBuffer.get();
       verboseResponse = deserializeState(root);
       fileDoc = nullptr;
     }
@@ -210,7 +229,12 @@ void initServer()
       request->send(200); return;
     }
     
-    if(handleSet(request, request->url())) return;
+    const String& url = request->url();
+    if (url.indexOf("win") >= 0 && postStateChange(STATE_CMD_HTTP, url.c_str(), url.length(), true)) {
+      if (url.indexOf(F("&IN")) < 0) XML_response(request);
+      return;
+    }
+    if(handleSet(request, url)) return;
     #ifndef WLED_DISABLE_ALEXA
     if(espalexa.handleAlexaApiCall(request)) return;
     #endif
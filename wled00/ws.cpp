@@ -9,8 +9,44 @@ uint16_t wsLiveClientId = 0;
 unsigned long wsLastLiveTime = 0;
 //uint8_t* wsFrameBuffer = nullptr;
 
+//state of a binary pixel block that is received in multiple packets
+uint32_t wsPixelClientId = 0;
+uint16_t wsPixelOffset = 0;
+byte wsPixelSeg = 255;
+bool wsPixelRgbw = false;
+byte wsPixelCarry[4];
+byte wsPixelCarryLen = 0;
+
 #define WS_LIVE_INTERVAL 40
 
+//queues a binary pixel block that is split over multiple packets or frames as its data arrives
+void wsPixelBlockPart(AsyncWebSocketClient * client, AwsFrameInfo * info, uint8_t *data, size_t len)
+{
+  if (info->num == 0 && info->index == 0) { //first packet, contains the header
+    wsPixelSeg = 255;
+    wsPixelCarryLen = 0;
+    if (len < PIXEL_BLOCK_HEADER_SIZE) return;
+    wsPixelClientId = client->id();
+    wsPixelSeg = data[0];
+    wsPixelRgbw = data[1] & PIXEL_BLOCK_FLAG_RGBW;
+    wsPixelOffset = (data[2] << 8) | data[3];
+    data += PIXEL_BLOCK_HEADER_SIZE; len -= PIXEL_BLOCK_HEADER_SIZE;
+  }
+  if (wsPixelSeg == 255 || client->id() != wsPixelClientId) return;
+
+  byte bpp = wsPixelRgbw ? 4 : 3;
+  if (wsPixelCarryLen) { //complete the pixel started in the previous packet
+    while (wsPixelCarryLen < bpp && len) {wsPixelCarry[wsPixelCarryLen++] = *data++; len--;}
+    if (wsPixelCarryLen < bpp) return;
+    postPixels(wsPixelSeg, wsPixelOffset++, wsPixelCarry, bpp, wsPixelRgbw);
+    wsPixelCarryLen = 0;
+  }
+  size_t whole = len - (len % bpp);
+  postPixels(wsPixelSeg, wsPixelOffset, data, whole, wsPixelRgbw);
+  wsPixelOffset += whole / bpp;
+  while (whole < len) wsPixelCarry[wsPixelCarryLen++] = data[whole++];
+}
+
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)
 {
   if(type == WS_EVT_CONNECT){
@@ -27,21 +63,26 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
       //the whole message is in a single frame and we got all of it's data (max. 1450byte)
       if(info->opcode == WS_TEXT)
       {
+        StaticJsonDocument<64> peek;
+        if (!peekStateRequest((const char*)data, len, peek)) return;
+        if (peek.containsKey("lv"))
+        {
+          wsLiveClientId = peek["lv"] ? client->id() : 0;
+        }
+        //applied with the next frame, the client gets the new state from there
+        if (postStateChange(STATE_CMD_JSON, (const char*)data, len, false, client->id())) return;
+
         bool verboseResponse = false;
         { //scope JsonDocument so it releases its buffer
-          DynamicJsonDocument jsonBuffer(JSON_BUFFER_SIZE);
-          DeserializationError error = deserializeJson(jsonBuffer, data, len);
-          JsonObject root = jsonBuffer.as<JsonObject>();
+          PooledJsonDoc jsonBuffer(jsonSizeForInput(len));
+          DeserializationError error = deserializeJson(*jsonBuffer, data, len);
+          JsonObject root = jsonBuffer->as<JsonObject>();
           if (error || root.isNull()) return;
-
-          if (root.containsKey("lv"))
-          {
-            wsLiveClientId = root["lv"] ? client->id() : 0;
-          }
-
           verboseResponse = deserializeState(root);
         }
         if (verboseResponse || millis() - lastInterfaceUpdate < 1900) sendDataWs(client); //update if it takes longer than 100ms until next "broadcast"
+      } else if (info->opcode == WS_BINARY) {
+        postPixelBlock(data, len);
       }
     } else {
       //message is comprised of multiple frames or the frame is split into multiple packets
@@ -54,6 +95,8 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
 
       //}
 
+      if (info->message_opcode == WS_BINARY) wsPixelBlockPart(client, info, data, len);
+
       if((info->index + len) == info->len){
         if(info->final){
           if(info->message_opcode == WS_TEXT) {
@@ -77,16 +120,16 @@ void sendDataWs(AsyncWebSocketClient * client)
   AsyncWebSocketMessageBuffer * buffer;
 
   { //scope JsonDocument so it releases its buffer
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    JsonObject state = doc.createNestedObject("state");
+    PooledJsonDoc doc(JSON_BUFFER_SIZE);
+    JsonObject state = doc->createNestedObject("state");
     serializeState(state);
-    JsonObject info  = doc.createNestedObject("info");
+    JsonObject info  = doc->createNestedObject("info");
     serializeInfo(info);
-    size_t len = measureJson(doc);
+    size_t len = measureJson(*doc);
     buffer = ws.makeBuffer(len);
     if (!buffer) return; //out of memory
 
-    serializeJson(doc, (char *)buffer->get(), len +1);
+    serializeJson(*doc, (char *)buffer->get(), len +1);
   } 
   if (client) {
     client->text(buffer);
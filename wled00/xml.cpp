@@ -285,7 +285,9 @@ void getSettingsJS(byte subPage, char* dest)
     sappend('c',SET_F("TF"),fadeTransition);
     sappend('v',SET_F("TD"),transitionDelayDefault);
     sappend('c',SET_F("PF"),strip.paletteFade);
+    sappend('c',SET_F("EF"),strip.effectFade);
     sappend('v',SET_F("BF"),briMultiplier);
+    sappend('v',SET_F("FR"),strip.getTargetFps());
     sappend('v',SET_F("TB"),nightlightTargetBri);
     sappend('v',SET_F("TL"),nightlightDelayMinsDefault);
     sappend('v',SET_F("TW"),nightlightMode);
@@ -314,6 +316,7 @@ void getSettingsJS(byte subPage, char* dest)
     sappend('c',SET_F("SH"),notifyHue);
     sappend('c',SET_F("SM"),notifyMacro);
     sappend('c',SET_F("S2"),notifyTwice);
+    sappend('c',SET_F("DE"),strip.deterministicMode);
     sappend('c',SET_F("RD"),receiveDirect);
     sappend('v',SET_F("EP"),e131Port);
     sappend('c',SET_F("ES"),e131SkipOutOfSequence);
@@ -345,6 +348,7 @@ void getSettingsJS(byte subPage, char* dest)
     sappends('s',SET_F("MQCID"),mqttClientID);
     sappends('s',SET_F("MD"),mqttDeviceTopic);
     sappends('s',SET_F("MG"),mqttGroupTopic);
+    sappend('v',SET_F("MQPERF"),perfMqttInterval);
     #endif
 
     #ifndef WLED_DISABLE_HUESYNC